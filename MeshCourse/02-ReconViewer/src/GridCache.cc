@@ -0,0 +1,113 @@
+//=============================================================================
+
+
+#include "GridCache.hh"
+#include <stdio.h>
+#include <string.h>
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+const char     MAGIC[4] = { 'G', 'R', 'D', 'C' };
+const uint32_t VERSION  = 1;
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+
+
+std::string GridCache::filename(uint64_t _key) const
+{
+	char name[32];
+	sprintf(name, "%08x%08x.grid", (unsigned int)(_key >> 32), (unsigned int)_key);
+
+	if (directory_.empty()) {
+		return name;
+	}
+	char last = directory_[directory_.size()-1];
+	if (last == '/' || last == '\\') {
+		return directory_ + name;
+	}
+	return directory_ + "/" + name;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool GridCache::load(uint64_t _key, IsoEx::ScalarGridT<float>& _grid) const
+{
+	FILE* in = fopen(filename(_key).c_str(), "rb");
+	if (!in) {
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version, res[3];
+	uint64_t key;
+	OpenMesh::Vec3f frame[4];	// origin and axes
+
+	bool ok =
+		fread(magic, 4, 1, in) == 1 && memcmp(magic, MAGIC, 4) == 0 &&
+		fread(&version, sizeof(version), 1, in) == 1 && version == VERSION &&
+		fread(&key, sizeof(key), 1, in) == 1 && key == _key &&
+		fread(frame, sizeof(frame), 1, in) == 1 &&
+		fread(res, sizeof(res), 1, in) == 1 &&
+		res[0] >= 2 && res[1] >= 2 && res[2] >= 2 &&
+		res[0] < 1024 && res[1] < 1024 && res[2] < 1024;
+
+	if (ok)
+	{
+		_grid.initialize(frame[0], frame[1], frame[2], frame[3], res[0], res[1], res[2]);
+		std::vector<float>& values = _grid.values();
+		values.resize(_grid.n_points());
+		ok = fread(&values[0], sizeof(float), values.size(), in) == values.size();
+	}
+
+	fclose(in);
+	return ok;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool GridCache::store(uint64_t _key, const IsoEx::ScalarGridT<float>& _grid) const
+{
+	const std::string name = filename(_key), tmp = name + ".tmp";
+	FILE* out = fopen(tmp.c_str(), "wb");
+	if (!out) {
+		return false;
+	}
+
+	OpenMesh::Vec3f frame[4] = { _grid.origin(), _grid.x_axis(), _grid.y_axis(), _grid.z_axis() };
+	uint32_t res[3] = { _grid.x_resolution(), _grid.y_resolution(), _grid.z_resolution() };
+	const std::vector<float>& values = _grid.values();
+
+	bool ok =
+		fwrite(MAGIC, 4, 1, out) == 1 &&
+		fwrite(&VERSION, sizeof(VERSION), 1, out) == 1 &&
+		fwrite(&_key, sizeof(_key), 1, out) == 1 &&
+		fwrite(frame, sizeof(frame), 1, out) == 1 &&
+		fwrite(res, sizeof(res), 1, out) == 1 &&
+		(values.empty() ||
+		 fwrite(&values[0], sizeof(float), values.size(), out) == values.size());
+	ok = (fclose(out) == 0) && ok;
+
+	// rename() does not replace existing files on Windows
+	if (ok) {
+		remove(name.c_str());
+		ok = rename(tmp.c_str(), name.c_str()) == 0;
+	}
+	if (!ok) {
+		remove(tmp.c_str());
+	}
+	return ok;
+}
+
+
+//=============================================================================
@@ -0,0 +1,92 @@
+//=============================================================================
+
+
+#ifndef GRIDCACHE_HH
+#define GRIDCACHE_HH
+
+
+//=============================================================================
+
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <IsoEx/Grids/ScalarGridT.hh>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//=============================================================================
+
+
+// 64 bit FNV-1a hash of everything a sampled grid depends on: the point set,
+// the method and kernel and their parameters, and the grid resolution. All
+// values are hashed by their binary representation, so the key is only
+// stable on machines with the same byte order and float format.
+class GridKey
+{
+public:
+
+	GridKey() : hash_(14695981039346656037ULL) {}
+
+	void add(const void* _data, size_t _size)
+	{
+		const unsigned char* p = (const unsigned char*)_data;
+		for (size_t i = 0; i < _size; i++) {
+			hash_ = (hash_ ^ p[i]) * 1099511628211ULL;
+		}
+	}
+
+	GridKey& operator<<(int _i)                { add(&_i, sizeof(_i)); return *this; }
+	GridKey& operator<<(float _f)              { add(&_f, sizeof(_f)); return *this; }
+	GridKey& operator<<(double _d)             { add(&_d, sizeof(_d)); return *this; }
+	GridKey& operator<<(const std::string& _s) { *this << (int)_s.size(); add(_s.data(), _s.size()); return *this; }
+
+	GridKey& operator<<(const std::vector<OpenMesh::Vec3f>& _v)
+	{
+		*this << (int)_v.size();
+		if (!_v.empty()) {
+			add(&_v[0], _v.size() * sizeof(OpenMesh::Vec3f));
+		}
+		return *this;
+	}
+
+	uint64_t value() const { return hash_; }
+
+private:
+
+	uint64_t hash_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+// Directory of sampled grids, one file "<key>.grid" per key (16 hex
+// digits). The file holds the 4 bytes "GRDC", a uint32 version, the uint64
+// key, the grid's origin and axes as 12 floats, the resolutions as 3
+// uint32 and the values as floats, x varying fastest. Files are written
+// under a temporary name and renamed, so concurrent runs never read a
+// partial grid.
+class GridCache
+{
+public:
+
+	GridCache(const std::string& _directory) : directory_(_directory) {}
+
+	// read the grid for _key including its geometry, false if there is
+	// none or the file is damaged
+	bool load(uint64_t _key, IsoEx::ScalarGridT<float>& _grid) const;
+
+	// store _grid under _key, replacing an older file
+	bool store(uint64_t _key, const IsoEx::ScalarGridT<float>& _grid) const;
+
+	std::string filename(uint64_t _key) const;
+
+private:
+
+	std::string directory_;
+};
+
+
+//=============================================================================
+#endif // GRIDCACHE_HH defined
+//=============================================================================
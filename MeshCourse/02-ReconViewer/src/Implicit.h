@@ -9,9 +9,18 @@ public:
 	typedef OpenMesh::Vec3f Vec3f;
 
 	Implicit(){}
-	~Implicit(){}
+	virtual ~Implicit(){}
 
 	virtual float operator()(const Vec3f& _p) const = 0;
+
+	// evaluate the _n points (_x[i],_y[i],_z[i]) given in structure-of-arrays
+	// layout, derived classes override this by vectorized code
+	virtual void operator()(const float* _x, const float* _y, const float* _z,
+		int _n, float* _values) const
+	{
+		for (int i = 0; i < _n; i++)
+			_values[i] = (*this)(Vec3f(_x[i], _y[i], _z[i]));
+	}
 };
 
 
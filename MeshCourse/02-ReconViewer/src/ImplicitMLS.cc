@@ -2,12 +2,16 @@
 
 
 #include "ImplicitMLS.hh"
+#include <IsoEx/Math/SSE.hh>
+#include <algorithm>
 
 
 //== IMPLEMENTATION ==========================================================
 ImplicitMLS::ImplicitMLS( const std::vector<Vec3f>& _points, 
-						 const std::vector<Vec3f>& _normals )
-						 : points_(_points), normals_(_normals), InvBetaSquare_(-1)
+						 const std::vector<Vec3f>& _normals, float _cutoff,
+						 int _adaptive_k )
+						 : points_(_points), normals_(_normals), InvBetaSquare_(-1),
+						   radius_(0), tree_(_points)
 {
 	//////////////////////////////////////////////////////////////////////
 	// INSERT CODE:
@@ -17,63 +21,172 @@ ImplicitMLS::ImplicitMLS( const std::vector<Vec3f>& _points,
 	float betha = calculateBetha();
 	assert(betha != 0 );
 	InvBetaSquare_ = 1.0 / (betha * betha);
+
+	// adaptive bandwidths: distance to the k-th neighbor of each point
+	if (_adaptive_k > 0)
+	{
+		int n = (int)points_.size();
+		inv_beta_sqr_.resize(n);
+		float max_betha(0);
+
+#pragma omp parallel
+		{
+			std::vector<int> neighbors;
+			float thread_max(0);
+
+#pragma omp for
+			for (int i = 0; i < n; i++) {
+				// the point itself is its own closest neighbor
+				tree_.knn_query(points_[i], _adaptive_k+1, neighbors);
+				float b = (points_[neighbors.back()] - points_[i]).length();
+				if (b == 0) b = betha;
+				inv_beta_sqr_[i] = 1.0f / (b * b);
+				thread_max = std::max(thread_max, b);
+			}
+
+#pragma omp critical
+			max_betha = std::max(max_betha, thread_max);
+		}
+
+		betha = max_betha;
+	}
+
+	radius_ = _cutoff * betha;
 }
 
 
 float ImplicitMLS::operator()(const Vec3f& _p) const
 {
-	float dist(0);
-	float d_i, phi_i, dist_i;
 	//////////////////////////////////////////////////////////////////////
 	// INSERT CODE:
 	// 1) compute MLS distance to tangent planes for point p_
 	//////////////////////////////////////////////////////////////////////
-	for (int i = 0; i < points_.size(); i++) {
-		dist_i = (_p - points_[i]).length();
-		d_i = normals_[i] | (_p - points_[i]);
-		phi_i = expf( -( (dist_i*dist_i) * InvBetaSquare_ ) );
-		dist += d_i * phi_i;
+	if (radius_ > 0)
+	{
+		// the gaussians are negligible outside of the cutoff radius
+		std::vector<int> neighbors;
+		tree_.radius_query(_p, radius_, neighbors);
+
+		// far from the samples use the closest tangent plane, which at
+		// least has the right sign
+		if (neighbors.empty()) {
+			int i = tree_.nearest(_p);
+			return (i < 0) ? 0 : (normals_[i] | (_p - points_[i]));
+		}
+
+		return sum_contributions(&neighbors[0], (int)neighbors.size(), _p);
 	}
 
-	return dist;
+	return sum_contributions(0, (int)points_.size(), _p);
 }
 
-//=============================================================================
 
-int ImplicitMLS::getEuclidClosestNeighbor(const int ptidx) const
+void ImplicitMLS::operator()(const float* _x, const float* _y, const float* _z,
+							 int _n, float* _values) const
 {
-	float curdist = -1;
-	float mindist = -1;
-	float closestNeighborIdx = -1;
-	const Vec3f& pt = points_[ptidx];
-	for (int i = 0; i < points_.size(); i++) {
-		if (ptidx == i) {
+	std::vector<int> neighbors;
+
+	for (int i = 0; i < _n; i++)
+	{
+		Vec3f p(_x[i], _y[i], _z[i]);
+
+		if (radius_ <= 0) {
+			_values[i] = sum_contributions(0, (int)points_.size(), p);
 			continue;
 		}
-		curdist = (points_[i] - pt).length();
-		if (closestNeighborIdx < 0 || curdist < mindist) {
-			closestNeighborIdx = i;
-			mindist = curdist;
+
+		tree_.radius_query(p, radius_, neighbors);
+		if (neighbors.empty()) {
+			_values[i] = (*this)(p);
+		}
+		else {
+			_values[i] = sum_contributions(&neighbors[0], (int)neighbors.size(), p);
 		}
 	}
-	assert(closestNeighborIdx > -1);
-	return closestNeighborIdx;
 }
 
-float ImplicitMLS::calculateBetha() const
+
+float ImplicitMLS::sum_contributions(const int* _indices, int _n,
+									 const Vec3f& _p) const
 {
-	float sum = 0;
-	int num = 0;
-	Vec3f closest;
-	for(int i = 0; i < points_.size(); i++) {
-		int j = getEuclidClosestNeighbor(i);
-		closest = points_[j];
-		sum += (closest - points_[i]).length();
-		num++;
+	float dist(0);
+	int   j(0);
+
+#ifdef ISOEX_SSE2
+	// four samples at a time, the gaussians by a vectorized exp()
+	const __m128 px = _mm_set1_ps(_p[0]), py = _mm_set1_ps(_p[1]), pz = _mm_set1_ps(_p[2]);
+	__m128 sum = _mm_setzero_ps();
+	int i[4];
+
+	for (; j+4 <= _n; j += 4)
+	{
+		for (int k = 0; k < 4; k++) {
+			i[k] = _indices ? _indices[j+k] : j+k;
+		}
+		const Vec3f &p0 = points_[i[0]], &p1 = points_[i[1]], &p2 = points_[i[2]], &p3 = points_[i[3]];
+		const Vec3f &n0 = normals_[i[0]], &n1 = normals_[i[1]], &n2 = normals_[i[2]], &n3 = normals_[i[3]];
+
+		__m128 dx = _mm_sub_ps(px, _mm_setr_ps(p0[0], p1[0], p2[0], p3[0]));
+		__m128 dy = _mm_sub_ps(py, _mm_setr_ps(p0[1], p1[1], p2[1], p3[1]));
+		__m128 dz = _mm_sub_ps(pz, _mm_setr_ps(p0[2], p1[2], p2[2], p3[2]));
+
+		__m128 d = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(dx, _mm_setr_ps(n0[0], n1[0], n2[0], n3[0])),
+			_mm_mul_ps(dy, _mm_setr_ps(n0[1], n1[1], n2[1], n3[1]))),
+			_mm_mul_ps(dz, _mm_setr_ps(n0[2], n1[2], n2[2], n3[2])));
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+			_mm_mul_ps(dz, dz));
+
+		__m128 inv_beta_sqr = inv_beta_sqr_.empty() ? _mm_set1_ps(InvBetaSquare_) :
+			_mm_setr_ps(inv_beta_sqr_[i[0]], inv_beta_sqr_[i[1]],
+			            inv_beta_sqr_[i[2]], inv_beta_sqr_[i[3]]);
+		__m128 phi = IsoEx::Math::exp_ps(_mm_sub_ps(_mm_setzero_ps(),
+			_mm_mul_ps(d2, inv_beta_sqr)));
+
+		sum = _mm_add_ps(sum, _mm_mul_ps(d, phi));
+	}
+	dist = IsoEx::Math::hsum_ps(sum);
+#endif
+
+	for (; j < _n; j++) {
+		dist += contribution(_indices ? _indices[j] : j, _p);
 	}
-	if (num == 0) {
+	return dist;
+}
+
+
+float ImplicitMLS::contribution(int _i, const Vec3f& _p) const
+{
+	Vec3f d = _p - points_[_i];
+	float inv_beta_sqr = inv_beta_sqr_.empty() ? InvBetaSquare_ : inv_beta_sqr_[_i];
+	return (normals_[_i] | d) * expf( -d.sqrnorm() * inv_beta_sqr );
+}
+
+//=============================================================================
+
+int ImplicitMLS::getEuclidClosestNeighbor(const int ptidx) const
+{
+	// the two closest points are ptidx itself and its neighbor, in either
+	// order if there are duplicates
+	std::vector<int> neighbors;
+	tree_.knn_query(points_[ptidx], 2, neighbors);
+	assert(neighbors.size() == 2);
+	return (neighbors[0] != ptidx) ? neighbors[0] : neighbors[1];
+}
+
+float ImplicitMLS::calculateBetha() const
+{
+	int num = (int)points_.size();
+	if (num < 2) {
 		return 0;
 	}
+
+	double sum = 0;
+#pragma omp parallel for reduction(+:sum)
+	for(int i = 0; i < num; i++) {
+		int j = getEuclidClosestNeighbor(i);
+		sum += (points_[j] - points_[i]).length();
+	}
 	float avg = sum / (float) num;
 	return 2*avg;
 }
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include <vector>
 #include <float.h>
 #include "Implicit.h"
+#include "KdTree.hh"
 
 //=============================================================================
 
@@ -23,19 +24,37 @@ public:
 	typedef OpenMesh::Vec3f Vec3f;
 
 
-	// fit RBF to given constraints
+	// fit RBF to given constraints. Only points within _cutoff * beta of a
+	// query point contribute to it, 0 sums over all points. By default beta
+	// is twice the average nearest neighbor distance, _adaptive_k > 0 uses
+	// the distance of each point to its k-th neighbor instead.
 	ImplicitMLS( const std::vector<Vec3f>& _points, 
-		const std::vector<Vec3f>& _normals );
+		const std::vector<Vec3f>& _normals, float _cutoff = 3.0f,
+		int _adaptive_k = 0 );
 
 	// evaluate implicit at position _p
 	float operator()(const Vec3f& _p) const;
 
+	// evaluate implicit at the _n points (_x[i],_y[i],_z[i])
+	void operator()(const float* _x, const float* _y, const float* _z,
+		int _n, float* _values) const;
+
 
 private:
 
 	const std::vector<Vec3f>&  points_;
 	const std::vector<Vec3f>&  normals_;
 	float                      InvBetaSquare_;
+	std::vector<float>         inv_beta_sqr_;	// per point, adaptive only
+	float                      radius_;		// cutoff radius, 0 for none
+	KdTree                     tree_;		// over points_
+
+	// weighted distance to the tangent plane of point _i
+	float contribution(int _i, const Vec3f& _p) const;
+
+	// sum of the contributions of the _n points _indices, or of the first
+	// _n points if _indices is 0
+	float sum_contributions(const int* _indices, int _n, const Vec3f& _p) const;
 
 	int getEuclidClosestNeighbor(const int ptidx) const; 
 	float calculateBetha() const;
@@ -0,0 +1,324 @@
+//=============================================================================
+
+
+#include "ImplicitPU.hh"
+#include <gmm.h>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <float.h>
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+// total weight below which the fallback function is blended in
+const double MIN_WEIGHT = 0.2;
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+ImplicitPU::ImplicitPU( const std::vector<Vec3f>& _points,
+					   const std::vector<Vec3f>& _normals, float _epsilon,
+					   int _max_points, float _overlap )
+					   : points_(_points), normals_(_normals), epsilon_(_epsilon),
+					     max_points_(std::max(_max_points, 1)), overlap_(_overlap),
+					     tree_(_points)
+{
+	int i, n = (int)points_.size();
+	if (n == 0) {
+		return;
+	}
+
+	// octree over the bounding cube of the samples
+	std::cout << "Building the octree" << std::endl << std::flush;
+	Vec3f bb_min(points_[0]), bb_max(points_[0]);
+	for (i = 1; i < n; i++) {
+		bb_min.minimize(points_[i]);
+		bb_max.maximize(points_[i]);
+	}
+
+	order_.resize(n);
+	for (i = 0; i < n; i++) {
+		order_[i] = i;
+	}
+
+	Node root;
+	root.center = (bb_min + bb_max) * 0.5f;
+	root.reach = 0;
+	root.child = -1;
+	root.fit = -1;
+	nodes_.push_back(root);
+	build(0, 0, n, 0.5f * (bb_max - bb_min).max() * 1.001f + FLT_MIN, 0);
+
+	// the local fits are independent of each other
+	std::cout << "Fitting " << fits_.size() << " local RBFs" << std::endl << std::flush;
+	int n_fits = (int)fits_.size(), n_failed = 0;
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:n_failed)
+	for (int f = 0; f < n_fits; f++) {
+		if (!fit(fits_[f])) {
+			n_failed++;
+		}
+	}
+
+	if (n_failed) {
+		std::cerr << n_failed << " singular local fits ignored" << std::endl;
+	}
+
+	// children are stored after their parents: accumulate the supports
+	// bottom-up
+	for (i = (int)nodes_.size()-1; i >= 0; i--)
+	{
+		Node& node = nodes_[i];
+		if (node.fit >= 0) {
+			node.reach = fits_[node.fit].radius;
+		}
+		else if (node.child >= 0) {
+			for (int c = node.child; c < node.child+8; c++) {
+				if (nodes_[c].reach > 0) {
+					node.reach = std::max(node.reach,
+						(nodes_[c].center - node.center).length() + nodes_[c].reach);
+				}
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void ImplicitPU::build(int _node, int _begin, int _end, float _half_size,
+					   int _depth)
+{
+	if (_end == _begin) {
+		return;
+	}
+
+	// leaf: remember the support, the fit is computed later
+	if (_end - _begin <= max_points_ || _depth == MAX_DEPTH)
+	{
+		Fit fit;
+		fit.center = nodes_[_node].center;
+		fit.radius = overlap_ * _half_size * sqrtf(3.0f);
+		nodes_[_node].fit = (int)fits_.size();
+		fits_.push_back(fit);
+		return;
+	}
+
+	// sort the samples into the octants
+	const Vec3f center = nodes_[_node].center;
+	std::vector<int> octant[8];
+	int i, c;
+	for (i = _begin; i < _end; i++)
+	{
+		const Vec3f& p = points_[order_[i]];
+		c = (p[0] > center[0] ? 1 : 0) | (p[1] > center[1] ? 2 : 0) |
+			(p[2] > center[2] ? 4 : 0);
+		octant[c].push_back(order_[i]);
+	}
+
+	int child = (int)nodes_.size();
+	nodes_[_node].child = child;
+	float h = 0.5f * _half_size;
+	for (c = 0; c < 8; c++)
+	{
+		Node node;
+		node.center = center + Vec3f((c & 1) ? h : -h, (c & 2) ? h : -h,
+			(c & 4) ? h : -h);
+		node.reach = 0;
+		node.child = -1;
+		node.fit = -1;
+		nodes_.push_back(node);
+	}
+
+	int begin = _begin;
+	for (c = 0; c < 8; c++)
+	{
+		int end = begin + (int)octant[c].size();
+		std::copy(octant[c].begin(), octant[c].end(), order_.begin() + begin);
+		octant[c].clear();
+		build(child + c, begin, end, h, _depth+1);
+		begin = end;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool ImplicitPU::fit(Fit& _fit) const
+{
+	// the samples closest to the cell center, all of them within the support
+	// but at least MIN_POINTS
+	std::vector<int> neighbors;
+	tree_.knn_query(_fit.center, 2 * max_points_, neighbors);
+
+	int k = 0;
+	while (k < (int)neighbors.size() &&
+		(points_[neighbors[k]] - _fit.center).length() <= _fit.radius) {
+			k++;
+	}
+	k = std::max(k, std::min((int)MIN_POINTS, (int)neighbors.size()));
+	neighbors.resize(k);
+	_fit.radius = std::max(_fit.radius,
+		(points_[neighbors.back()] - _fit.center).length());
+	_fit.indices = neighbors;
+
+	// constraints in coordinates relative to the support sphere
+	const float scale = 1.0f / _fit.radius;
+	std::vector<Vec3f> centers(2*k);
+	std::vector<double> B(2*k + 4, 0.0);
+	for (int i = 0; i < k; i++) {
+		int j = neighbors[i];
+		centers[i]   = (points_[j] - _fit.center) * scale;
+		centers[k+i] = (points_[j] + normals_[j] * epsilon_ - _fit.center) * scale;
+		B[k+i] = epsilon_;
+	}
+
+	// triharmonic kernel plus affine polynomial:
+	//   | A   P | |w|   |b|
+	//   | P^T 0 | |a| = |0|
+	int m = 2*k, row, col;
+	gmm::dense_matrix<double> M(m+4, m+4);
+	for (row = 0; row < m; row++)
+	{
+		for (col = 0; col < m; col++) {
+			double r = (centers[row] - centers[col]).length();
+			M(row, col) = r * r * r;
+		}
+		M(row, m) = M(m, row) = 1.0;
+		for (col = 0; col < 3; col++) {
+			M(row, m+1+col) = M(m+1+col, row) = centers[row][col];
+		}
+	}
+
+	std::vector<double> X(m+4);
+	std::vector<size_t> ipvt(m+4);
+	if (gmm::lu_factor(M, ipvt) != 0) {
+		_fit.weights.clear();
+		return false;
+	}
+	gmm::lu_solve(M, ipvt, X, B);
+
+	_fit.weights.swap(X);
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+float ImplicitPU::evaluate(const Fit& _fit, const Vec3f& _p) const
+{
+	const float scale = 1.0f / _fit.radius;
+	const Vec3f q = (_p - _fit.center) * scale;
+	const int k = (int)_fit.indices.size();
+	const double* w = &_fit.weights[0];
+
+	double f = w[2*k] + w[2*k+1]*q[0] + w[2*k+2]*q[1] + w[2*k+3]*q[2];
+	for (int i = 0; i < k; i++)
+	{
+		int j = _fit.indices[i];
+		Vec3f c = (points_[j] - _fit.center) * scale;
+		double r = (q - c).length();
+		f += w[i] * r * r * r;
+
+		c = (points_[j] + normals_[j] * epsilon_ - _fit.center) * scale;
+		r = (q - c).length();
+		f += w[k+i] * r * r * r;
+	}
+	return (float)f;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+float ImplicitPU::weight(float _t)
+{
+	// quadratic B-spline, C^1 and zero for _t >= 1
+	float s = 1.5f * _t;
+	if (s < 0.5f) {
+		return 0.75f - s*s;
+	}
+	if (s < 1.5f) {
+		return 0.5f * (1.5f - s) * (1.5f - s);
+	}
+	return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+float ImplicitPU::operator()(const Vec3f& _p) const
+{
+	double sum_wf(0), sum_w(0);
+
+	// visit all fits whose support contains _p
+	int stack[8 * MAX_DEPTH + 8];
+	int top = 0;
+	if (!nodes_.empty()) {
+		stack[top++] = 0;
+	}
+
+	while (top > 0)
+	{
+		const Node& node = nodes_[stack[--top]];
+		if (node.reach <= 0 || (_p - node.center).sqrnorm() >= node.reach * node.reach) {
+			continue;
+		}
+
+		if (node.fit >= 0)
+		{
+			const Fit& fit = fits_[node.fit];
+			if (fit.weights.empty()) {
+				continue;
+			}
+			float w = weight((_p - fit.center).length() / fit.radius);
+			if (w > 0) {
+				sum_wf += w * evaluate(fit, _p);
+				sum_w  += w;
+			}
+		}
+		else if (node.child >= 0) {
+			for (int c = 0; c < 8; c++) {
+				stack[top++] = node.child + c;
+			}
+		}
+	}
+
+	// where the supports thin out, fade to the closest tangent plane, which
+	// at least has the right sign. Without it the local fits' extrapolation
+	// creates spurious surface components.
+	if (sum_w >= MIN_WEIGHT) {
+		return (float)(sum_wf / sum_w);
+	}
+
+	int i = tree_.nearest(_p);
+	double g = (i < 0) ? 0 : (normals_[i] | (_p - points_[i]));
+	return (float)((sum_wf + (MIN_WEIGHT - sum_w) * g) / MIN_WEIGHT);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void ImplicitPU::operator()(const float* _x, const float* _y, const float* _z,
+							int _n, float* _values) const
+{
+	// the fits visited differ from point to point, no batching here
+	for (int i = 0; i < _n; i++) {
+		_values[i] = (*this)(Vec3f(_x[i], _y[i], _z[i]));
+	}
+}
+
+
+//=============================================================================
@@ -0,0 +1,110 @@
+//=============================================================================
+
+
+#ifndef PU_HH
+#define PU_HH
+
+
+//=============================================================================
+
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <vector>
+#include "Implicit.h"
+#include "KdTree.hh"
+
+//=============================================================================
+
+
+// Partition of unity reconstruction for large point sets.
+//
+// An octree splits the bounding cube of the samples until every cell holds
+// at most _max_points samples. Each non-empty leaf c gets a small triharmonic
+// RBF fit f_c (plus an affine polynomial) to the samples within its support
+// sphere, whose radius is _overlap times the half diagonal of the cell. The
+// fits are independent and solved in parallel. They are blended by
+//
+//   f(x) = sum_c w_c(x) f_c(x) / sum_c w_c(x)
+//
+// with quadratic B-spline weights w_c that vanish outside the support
+// spheres. Where the weights sum up to little, i.e. away from the samples,
+// the distance to the closest tangent plane is blended in. Fitting and
+// evaluation cost O(n) resp. O(log n), as opposed to the O(n^3) dense solve
+// of a global ImplicitRBF.
+class ImplicitPU : Implicit
+{
+public:
+
+	typedef OpenMesh::Vec3f Vec3f;
+
+	// fit local RBFs with on-surface constraints at the _points and
+	// off-surface constraints at distance _epsilon along the _normals
+	ImplicitPU( const std::vector<Vec3f>& _points,
+		const std::vector<Vec3f>& _normals, float _epsilon,
+		int _max_points = 32, float _overlap = 1.5f );
+
+	// evaluate implicit at position _p
+	float operator()(const Vec3f& _p) const;
+
+	// evaluate implicit at the _n points (_x[i],_y[i],_z[i])
+	void operator()(const float* _x, const float* _y, const float* _z,
+		int _n, float* _values) const;
+
+	// number of local fits
+	int n_fits() const { return (int)fits_.size(); }
+
+
+private:
+
+	struct Node
+	{
+		Vec3f	center;		// center of the cell
+		float	reach;		// all supports of the subtree lie within this
+						// distance of center, 0 for empty subtrees
+		int		child;		// index of the first of 8 children, -1 for leaves
+		int		fit;		// index into fits_, -1 for none
+	};
+
+	struct Fit
+	{
+		Vec3f				center;
+		float				radius;		// support radius
+		std::vector<int>	indices;	// samples used by the fit
+		std::vector<double>	weights;	// 2 per sample, then the affine
+										// part; empty if the fit failed
+	};
+
+	void build(int _node, int _begin, int _end, float _half_size, int _depth);
+
+	// fit the local RBF of _fit, returns false for a singular system
+	bool fit(Fit& _fit) const;
+
+	float evaluate(const Fit& _fit, const Vec3f& _p) const;
+
+	// weight function of a support sphere, _t = distance / radius
+	static float weight(float _t);
+
+private:
+
+	// fits use at least this many and at most 2 * _max_points samples,
+	// the ones closest to the cell center
+	enum { MIN_POINTS = 16 };
+
+	// cells are not refined beyond this depth
+	enum { MAX_DEPTH = 12 };
+
+	std::vector<Vec3f>	points_;
+	std::vector<Vec3f>	normals_;
+	float				epsilon_;
+	int					max_points_;
+	float				overlap_;
+	KdTree				tree_;		// over points_
+	std::vector<int>	order_;		// samples sorted into the octree cells
+	std::vector<Node>	nodes_;
+	std::vector<Fit>	fits_;
+};
+
+
+//=============================================================================
+#endif // PU_HH defined
+//=============================================================================
@@ -2,19 +2,76 @@
 
 
 #include "ImplicitRBF.hh"
+#include <IsoEx/Math/GMRES.hh>
+#include <algorithm>
+#include <cmath>
 
 
 //== IMPLEMENTATION ==========================================================
 
 
-ImplicitRBF::ImplicitRBF(	const std::vector<Vec3f>& _points, 
+namespace {
+
+// iterative refinement stops at this relative residual
+const double REFINEMENT_TOLERANCE = 1e-12;
+
+// single precision solves that do not refine below this relative residual
+// are repeated in double precision
+const double SINGLE_PRECISION_FAILURE = 1e-6;
+
+// GMRES of fit_matrix_free() stops at this relative residual (2-norm)
+const double GMRES_TOLERANCE = 1e-10;
+
+// matrix-free fits whose relative residual (max. norm) is above this and
+// above the far-field tolerance have failed
+const double FIT_TOLERANCE = 1e-6;
+
+// compactly supported kernels whose support covers at least this fraction
+// of the centers are fitted with a dense matrix
+const double SPARSE_FRACTION = 0.1;
+
+// distances of the points (_x[i],_y[i],_z[i]) to _c in double precision
+void distances(const OpenMesh::Vec3f& _c, const double* _x, const double* _y,
+			   const double* _z, int _n, double* _dist)
+{
+	int i = 0;
+#ifdef ISOEX_SSE2
+	const __m128d cx = _mm_set1_pd(_c[0]), cy = _mm_set1_pd(_c[1]), cz = _mm_set1_pd(_c[2]);
+	for (; i+2 <= _n; i += 2) {
+		__m128d dx = _mm_sub_pd(_mm_loadu_pd(_x+i), cx);
+		__m128d dy = _mm_sub_pd(_mm_loadu_pd(_y+i), cy);
+		__m128d dz = _mm_sub_pd(_mm_loadu_pd(_z+i), cz);
+		__m128d d2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)),
+			_mm_mul_pd(dz, dz));
+		_mm_storeu_pd(_dist+i, _mm_sqrt_pd(d2));
+	}
+#endif
+	for (; i < _n; i++) {
+		_dist[i] = (OpenMesh::Vec3d(_x[i], _y[i], _z[i]) - OpenMesh::Vec3d(_c)).norm();
+	}
+}
+
+}
+
+
+template <class Kernel>
+ImplicitRBFT<Kernel>::ImplicitRBFT(	const std::vector<Vec3f>& _points, 
 						 const std::vector<Vec3f>& _normals, 
 						 float& epsilon, 
-						 RBF& _rbf
+						 const Kernel& _rbf,
+						 double _greedy_tolerance,
+						 RbfSolver _solver,
+						 double _far_field_tolerance
 						 ) :
 rbf_(_rbf),
 	epsilon_(epsilon)
 {
+	affine_[0] = affine_[1] = affine_[2] = affine_[3] = 0;
+	solver_ = _solver;
+	far_field_tolerance_ = _far_field_tolerance;
+	residual_ = 0;
+	converged_ = true;
+
 	//////////////////////////////////////////////////////////////////////
 	// INSERT CODE:
 	// 1) collect constraints (on-surface and off-surface)
@@ -33,55 +90,875 @@ rbf_(_rbf),
 		vals.push_back(epsilon);
 	}
 
-	std::cout << "Filling the matrix" << std::endl << std::flush;
-	gmmMatrix M(2*n,2*n);
-	for (int row = 0; row < 2*n; row++) {
+	if (_greedy_tolerance > 0) {
+		std::vector<Vec3f> constraints;
+		constraints.swap(centers_);
+		fit_greedy(constraints, vals, _greedy_tolerance);
+	}
+	else {
+		fit(vals);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::fit(const std::vector<float>& _vals, bool _affine)
+{
+	if (rbf_.support() > 0) {
+		// the tree also serves the evaluation
+		tree_.build(centers_);
+		double fraction = neighbor_fraction();
+		if (fraction < SPARSE_FRACTION) {
+			fit_sparse(_vals);
+		}
+		else {
+			// the support covers most of the centers, the sparse matrix
+			// would be dense and ILUT + GMRES slower than LDL^T
+			std::cout << "Kernel support covers " << 100 * fraction
+				<< "% of the centers, fitting with a dense matrix" << std::endl << std::flush;
+			fit_dense(_vals, false);
+		}
+	}
+	else if (solver_ == RBF_MATRIX_FREE) {
+		fit_matrix_free(_vals);
+	}
+	else {
+		fit_dense(_vals, _affine);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+namespace {
+
+// deterministic random numbers in [0,_n) for std::random_shuffle
+struct Lcg
+{
+	Lcg() : state_(12345) {}
+	int operator()(int _n)
+	{
+		state_ = state_ * 1103515245u + 12345u;
+		return (int)((state_ >> 8) % (unsigned int)_n);
+	}
+	unsigned int state_;
+};
+
+// orders center indices by one coordinate
+struct CoordinateLess
+{
+	CoordinateLess(const std::vector<OpenMesh::Vec3f>& _points, int _axis)
+		: points_(_points), axis_(_axis) {}
+	bool operator()(int _i, int _j) const { return points_[_i][axis_] < points_[_j][axis_]; }
+	const std::vector<OpenMesh::Vec3f>& points_;
+	int axis_;
+};
+
+// orders center indices lexicographically by position
+struct PositionLess
+{
+	PositionLess(const std::vector<OpenMesh::Vec3f>& _points) : points_(_points) {}
+	bool operator()(int _i, int _j) const
+	{
+		const OpenMesh::Vec3f &p = points_[_i], &q = points_[_j];
+		if (p[0] != q[0]) return p[0] < q[0];
+		if (p[1] != q[1]) return p[1] < q[1];
+		return p[2] < q[2];
+	}
+	const std::vector<OpenMesh::Vec3f>& points_;
+};
+
+// center indices at the same position
+struct SamePosition
+{
+	SamePosition(const std::vector<OpenMesh::Vec3f>& _points) : points_(_points) {}
+	bool operator()(int _i, int _j) const { return points_[_i] == points_[_j]; }
+	const std::vector<OpenMesh::Vec3f>& points_;
+};
+
+// orders constraint indices by decreasing residual
+struct LargerResidual
+{
+	LargerResidual(const std::vector<float>& _residuals) : residuals_(_residuals) {}
+	bool operator()(int _i, int _j) const { return residuals_[_i] > residuals_[_j]; }
+	const std::vector<float>& residuals_;
+};
+
+}
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::fit_greedy(const std::vector<Vec3f>& _constraints,
+							 const std::vector<float>& _vals,
+							 double _tolerance)
+{
+	int i, n = (int)_constraints.size();
+	if (n == 0) {
+		centers_.clear();
+		weights_.clear();
+		return;
+	}
+
+	// constraint positions in structure-of-arrays layout for the batch
+	// evaluation
+	std::vector<float> x(n), y(n), z(n), f(n), residuals(n);
+	Vec3f bb_min(_constraints[0]), bb_max(_constraints[0]);
+	for (i = 0; i < n; i++) {
+		x[i] = _constraints[i][0];
+		y[i] = _constraints[i][1];
+		z[i] = _constraints[i][2];
+		bb_min.minimize(_constraints[i]);
+		bb_max.maximize(_constraints[i]);
+	}
+	float diagonal = (bb_max - bb_min).norm();
+
+	// random initial subset
+	std::vector<int> order(n);
+	for (i = 0; i < n; i++) {
+		order[i] = i;
+	}
+	Lcg rng;
+	std::random_shuffle(order.begin(), order.end(), rng);
+
+	std::vector<bool> used(n, false);
+	std::vector<int> selected(order.begin(),
+		order.begin() + std::min(n, std::max(64, n/50)));
+
+	std::vector<float> vals;
+	std::vector<int> candidates;
+	for (;;)
+	{
+		centers_.clear();
+		vals.clear();
+		for (i = 0; i < (int)selected.size(); i++) {
+			used[selected[i]] = true;
+			centers_.push_back(_constraints[selected[i]]);
+			vals.push_back(_vals[selected[i]]);
+		}
+		fit(vals, true);
+
+		// residuals of the constraints that are not centers yet
+		(*this)(&x[0], &y[0], &z[0], n, &f[0]);
+		candidates.clear();
+		float max_residual(0);
+		for (i = 0; i < n; i++) {
+			residuals[i] = std::fabs(f[i] - _vals[i]);
+			if (!used[i]) {
+				max_residual = std::max(max_residual, residuals[i]);
+				if (residuals[i] > _tolerance) {
+					candidates.push_back(i);
+				}
+			}
+		}
+
+		std::cout << "Greedy fit: " << centers_.size() << " of " << n
+			<< " centers, max. residual " << max_residual << std::endl << std::flush;
+		if (candidates.empty()) {
+			break;
+		}
+
+		// add the worst constraints, the number of centers grows
+		// geometrically to keep the number of refits small. Constraints
+		// closer than the average center spacing to one added in the same
+		// round are skipped: the interpolant overshoots between clusters of
+		// new centers.
+		int k = std::min((int)candidates.size(),
+			std::max(16, (int)selected.size() / 2));
+		std::sort(candidates.begin(), candidates.end(), LargerResidual(residuals));
+		float spacing = 0.5f * diagonal / std::pow(float(selected.size() + k), 1.0f/3.0f);
+		float spacing2 = spacing * spacing;
+		int added = (int)selected.size();
+		for (i = 0; i < (int)candidates.size() && (int)selected.size() - added < k; i++) {
+			const Vec3f& c = _constraints[candidates[i]];
+			int j = added;
+			while (j < (int)selected.size() && (_constraints[selected[j]] - c).sqrnorm() >= spacing2) {
+				j++;
+			}
+			if (j == (int)selected.size()) {
+				selected.push_back(candidates[i]);
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::fit_dense(const std::vector<float>& _vals, bool _affine)
+{
+	int i, n = centers_.size();
+	int m = _affine ? n+4 : n;
+
+	gmmVector B(m, 0.0);
+	for (i = 0; i < n; i++) {
+		B[i] = _vals[i];
+	}
+	gmmVector X(B), R(m);
+	double b_norm = 0;
+	for (i = 0; i < m; i++) {
+		b_norm = std::max(b_norm, std::fabs(B[i]));
+	}
+	if (b_norm == 0) {
+		// all values 0, residuals are absolute
+		b_norm = 1;
+	}
+
+	if (solver_ == RBF_DENSE_SINGLE) {
+		// half the memory and twice the SIMD width of double precision.
+		// Iterative refinement recovers the accuracy if the condition
+		// number of the matrix is below 1e7, each step reduces the residual
+		// by about the condition number times the float precision.
+		std::cout << "Filling the matrix (single precision)" << std::endl << std::flush;
+		IsoEx::Math::LDLTSolverT<float> M(m);
+		fill_matrix(M, _affine);
+
+		std::cout << "Solving the linear system" << std::endl << std::flush;
+		solve_linear_system(M, X);
+		residual_ = residual(B, X, R, _affine) / b_norm;
+
+		// correct by the solution for the residual until it stops decreasing
+		gmmVector Y(m);
+		int steps = 0;
+		for (; converged_ && steps < MAX_REFINEMENT_STEPS && residual_ > REFINEMENT_TOLERANCE; steps++) {
+			M.solve(R);
+			for (i = 0; i < m; i++) {
+				Y[i] = X[i] + R[i];
+			}
+			double r = residual(B, Y, R, _affine) / b_norm;
+			if (r >= residual_) {
+				break;
+			}
+			X.swap(Y);
+			residual_ = r;
+		}
+		std::cout << steps << " refinement steps" << std::endl << std::flush;
+
+		if (!converged_ || !(residual_ <= SINGLE_PRECISION_FAILURE)) {
+			std::cout << "Relative residual " << residual_
+				<< ", too ill-conditioned for single precision" << std::endl;
+			X = B;
+		}
+	}
+
+	if (solver_ != RBF_DENSE_SINGLE || !converged_ || !(residual_ <= SINGLE_PRECISION_FAILURE)) {
+		std::cout << "Filling the matrix" << std::endl << std::flush;
+		DenseSolver M(m);
+		fill_matrix(M, _affine);
+
+		std::cout << "Solving the linear system" << std::endl << std::flush;
+		solve_linear_system(M, X);
+		residual_ = residual(B, X, R, _affine) / b_norm;
+	}
+	std::cout << "Relative residual " << residual_ << std::endl << std::flush;
+
+	weights_.assign(X.begin(), X.begin() + n);
+	for (int k = 0; k < 4; k++) {
+		affine_[k] = _affine ? X[n+k] : 0.0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+template <class Matrix>
+void ImplicitRBFT<Kernel>::fill_matrix(Matrix& _M, bool _affine) const
+{
+	int n = centers_.size();
+
+#pragma omp parallel for schedule(dynamic, 16)
+	for (int row = 0; row < n; row++) {
 		Vec3f p_i = centers_[row];
-		for (int col = 0; col < 2*n; col++) {
-			Vec3f c_i = centers_[col];
-			M(row,col) = kernel(p_i, c_i);
+		for (int col = 0; col <= row; col++) {
+			_M(row,col) = kernel(p_i, centers_[col]);
+		}
+	}
+
+	// affine part, orthogonal to the weights:
+	//   | A   P | |w|   |b|
+	//   | P^T 0 | |a| = |0|
+	if (_affine) {
+		for (int col = 0; col < n; col++) {
+			_M(n,col) = 1.0;
+			for (int k = 0; k < 3; k++) {
+				_M(n+1+k,col) = centers_[col][k];
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+double ImplicitRBFT<Kernel>::residual(const gmmVector& _b, const gmmVector& _x,
+									  gmmVector& _r, bool _affine) const
+{
+	multiply(_x, _r, _affine);
+
+	double r_norm = 0;
+	for (unsigned int i = 0; i < _r.size(); i++) {
+		_r[i] = _b[i] - _r[i];
+		r_norm = std::max(r_norm, std::fabs(_r[i]));
+	}
+	return r_norm;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::multiply(const gmmVector& _x, gmmVector& _y,
+									bool _affine) const
+{
+	int i, n = centers_.size();
+
+	std::vector<double> x(n), y(n), z(n);
+	for (i = 0; i < n; i++) {
+		x[i] = centers_[i][0];
+		y[i] = centers_[i][1];
+		z[i] = centers_[i][2];
+	}
+
+	// rows in parallel, columns in tiles whose distances and kernel values
+	// stay in the cache. In double precision like fill_matrix(), the
+	// residuals of the dense solvers and the iteration of fit_matrix_free()
+	// depend on it.
+#pragma omp parallel
+	{
+		std::vector<double> dist(TILE_SIZE), phi(TILE_SIZE);
+
+#pragma omp for schedule(dynamic, 16)
+		for (int row = 0; row < n; row++) {
+			double f = 0;
+			for (int col = 0; col < n; col += TILE_SIZE) {
+				int m = std::min((int)TILE_SIZE, n - col);
+				distances(centers_[row], &x[col], &y[col], &z[col], m, &dist[0]);
+				rbf_.evaluate(&dist[0], m, &phi[0]);
+				for (int j = 0; j < m; j++) {
+					f += phi[j] * _x[col+j];
+				}
+			}
+			_y[row] = f;
+		}
+	}
+
+	// affine part, see fill_matrix()
+	if (_affine) {
+		for (i = 0; i < 4; i++) {
+			_y[n+i] = 0;
+		}
+		for (i = 0; i < n; i++) {
+			const Vec3f& c = centers_[i];
+			_y[i] += _x[n] + c[0]*_x[n+1] + c[1]*_x[n+2] + c[2]*_x[n+3];
+			_y[n]   += _x[i];
+			_y[n+1] += c[0] * _x[i];
+			_y[n+2] += c[1] * _x[i];
+			_y[n+3] += c[2] * _x[i];
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::fit_matrix_free(const std::vector<float>& _vals)
+{
+	int i, n = centers_.size();
+
+	gmmVector B(n+4, 0.0), X(n+4, 0.0), R(n+4);
+	double b_norm = 0;
+	for (i = 0; i < n; i++) {
+		B[i] = _vals[i];
+		b_norm = std::max(b_norm, std::fabs(B[i]));
+	}
+
+	std::cout << "Building the preconditioner" << std::endl << std::flush;
+	Preconditioner M(*this);
+	Product A(*this, far_field_tolerance_ * b_norm);
+
+	std::cout << "Solving the linear system matrix-free" << std::endl << std::flush;
+	const double tolerance = std::max(GMRES_TOLERANCE, far_field_tolerance_);
+	double reached = tolerance;
+	int iterations = IsoEx::Math::gmres(A, M, B, X, GMRES_RESTART,
+		MAX_GMRES_ITERATIONS, reached);
+	if (reached > tolerance) {
+		std::cerr << "GMRES stopped after " << iterations
+			<< " iterations at relative residual " << reached << std::endl;
+	}
+	residual_ = residual(B, X, R, true) / b_norm;
+
+	// the treecode error of a product is only estimated and GMRES does not
+	// see it. Correct by the solution for the exact residual until it stops
+	// decreasing. The corrections only have to reduce the residual to a
+	// tenth of the tolerance, with products accurate to that tenth.
+	const double fit_tolerance = std::max(FIT_TOLERANCE, far_field_tolerance_);
+	gmmVector D(n+4), Y(n+4);
+	int steps = 0;
+	for (; steps < MAX_REFINEMENT_STEPS && residual_ > fit_tolerance; steps++) {
+		A.set_tolerance(0.1 * fit_tolerance * b_norm);
+		D.assign(n+4, 0.0);
+		reached = std::max(GMRES_TOLERANCE, 0.1 * fit_tolerance / residual_);
+		iterations += IsoEx::Math::gmres(A, M, R, D, GMRES_RESTART,
+			MAX_GMRES_ITERATIONS, reached);
+		for (i = 0; i < n+4; i++) {
+			Y[i] = X[i] + D[i];
+		}
+		double r = residual(B, Y, D, true) / b_norm;
+		if (!(r < residual_)) {
+			break;
+		}
+		X.swap(Y);
+		R.swap(D);
+		residual_ = r;
+	}
+
+	std::cout << iterations << " GMRES iterations, " << steps
+		<< " correction steps, relative residual " << residual_ << std::endl << std::flush;
+
+	converged_ = (residual_ <= fit_tolerance);
+	if (!converged_) {
+		std::cerr << "Matrix-free fit failed: relative residual " << residual_
+			<< " is above " << fit_tolerance << std::endl;
+	}
+
+	weights_.assign(X.begin(), X.begin() + n);
+	for (int k = 0; k < 4; k++) {
+		affine_[k] = X[n+k];
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+ImplicitRBFT<Kernel>::Product::Product(const ImplicitRBFT& _rbf,
+									   double _far_field_tolerance)
+	: rbf_(_rbf)
+{
+	if (_far_field_tolerance > 0 && Kernel::TREECODE) {
+		far_field_.build(rbf_.centers_);
+		far_field_.set_tolerance(_far_field_tolerance);
+	}
+}
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::Product::set_tolerance(double _far_field_tolerance) const
+{
+	if (!far_field_.empty()) {
+		far_field_.set_tolerance(_far_field_tolerance);
+	}
+}
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::Product::operator()(const gmmVector& _x, gmmVector& _y) const
+{
+	if (far_field_.empty()) {
+		rbf_.multiply(_x, _y, true);
+		return;
+	}
+
+	int i, n = rbf_.centers_.size();
+	gmmVector w(_x.begin(), _x.begin() + n);
+	far_field_.set_weights(w);
+
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int row = 0; row < n; row++) {
+		_y[row] = far_field_(rbf_.centers_[row]);
+	}
+
+	// affine part, see fill_matrix()
+	for (i = 0; i < 4; i++) {
+		_y[n+i] = 0;
+	}
+	for (i = 0; i < n; i++) {
+		const Vec3f& c = rbf_.centers_[i];
+		_y[i] += _x[n] + c[0]*_x[n+1] + c[1]*_x[n+2] + c[2]*_x[n+3];
+		_y[n]   += _x[i];
+		_y[n+1] += c[0] * _x[i];
+		_y[n+2] += c[1] * _x[i];
+		_y[n+3] += c[2] * _x[i];
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+ImplicitRBFT<Kernel>::Preconditioner::Preconditioner(const ImplicitRBFT& _rbf)
+	: rbf_(_rbf)
+{
+	const std::vector<Vec3f>& centers = rbf_.centers_;
+	int i, n = centers.size();
+
+	std::vector<int> indices(n);
+	for (i = 0; i < n; i++) {
+		indices[i] = i;
+	}
+	std::vector< std::pair<int,int> > clusters;
+	split(indices, 0, n, clusters);
+
+	KdTree tree(centers);
+	subdomains_.resize(clusters.size());
+	std::vector<char> factorized(clusters.size());
+
+	// factorize the local systems in parallel
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int d = 0; d < (int)clusters.size(); d++) {
+		Subdomain& sub = subdomains_[d];
+		int begin = clusters[d].first, end = clusters[d].second;
+
+		// the cluster, then the nearest neighbors of its centroid
+		Vec3f centroid(0, 0, 0);
+		sub.indices.assign(indices.begin() + begin, indices.begin() + end);
+		for (int j = begin; j < end; j++) {
+			centroid += centers[indices[j]];
+		}
+		centroid /= (float)(end - begin);
+
+		std::vector<int> neighbors;
+		tree.knn_query(centroid, SUBDOMAIN_SIZE, neighbors);
+		std::sort(sub.indices.begin(), sub.indices.end());
+		for (unsigned int j = 0; j < neighbors.size(); j++) {
+			if (!std::binary_search(sub.indices.begin(), sub.indices.begin() + (end - begin),
+				neighbors[j])) {
+				sub.indices.push_back(neighbors[j]);
+			}
+		}
+		factorized[d] = factorize(sub);
+	}
+
+	// drop subdomains that are singular even without coincident centers,
+	// the preconditioner is weaker then, but still consistent
+	int n_sub = 0;
+	for (int d = 0; d < (int)subdomains_.size(); d++) {
+		if (factorized[d]) {
+			if (n_sub != d) {
+				subdomains_[n_sub] = subdomains_[d];
+			}
+			n_sub++;
+		}
+	}
+	if (n_sub < (int)subdomains_.size()) {
+		std::cerr << "Dropped " << subdomains_.size() - n_sub
+			<< " singular subdomains" << std::endl;
+	}
+	subdomains_.resize(n_sub);
+
+	// split() ordered the centers spatially, evenly spaced ones in this
+	// order cover the whole point set
+	int n_coarse = std::min(n, (int)COARSE_SIZE);
+	for (i = 0; i < n_coarse; i++) {
+		coarse_.indices.push_back(indices[(int)((long long)i * n / n_coarse)]);
+	}
+	if (!factorize(coarse_)) {
+		std::cerr << "Dropped the singular coarse level" << std::endl;
+		coarse_.indices.clear();
+	}
+
+	// the residual of a center is only needed until its last subdomain
+	last_.assign(n, -1);
+	for (int d = 0; d < (int)subdomains_.size(); d++) {
+		for (i = 0; i < (int)subdomains_[d].indices.size(); i++) {
+			last_[subdomains_[d].indices[i]] = d;
 		}
 	}
-	gmmVector B(2*n);
-	for (int i = 0; i < B.size(); i++) {
-		B[i] = vals[i];
+	for (i = 0; i < (int)coarse_.indices.size(); i++) {
+		last_[coarse_.indices[i]] = subdomains_.size();
 	}
-	gmmVector X(2*n);
 
-	std::cout << "Solving the linear system" << std::endl << std::flush;
-	solve_linear_system(M, B, X);
+	std::cout << subdomains_.size() << " subdomains" << std::endl << std::flush;
+}
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::Preconditioner::split(std::vector<int>& _indices,
+												 int _begin, int _end,
+												 std::vector< std::pair<int,int> >& _clusters) const
+{
+	if (_end - _begin <= CLUSTER_SIZE) {
+		_clusters.push_back(std::make_pair(_begin, _end));
+		return;
+	}
 
-	weights_.clear();
-	weights_.resize(X.size());
-	for (int i = 0; i < B.size(); i++) {
-		weights_[i] = X[i];
+	// split the longest side of the bounding box
+	const std::vector<Vec3f>& centers = rbf_.centers_;
+	Vec3f bb_min(centers[_indices[_begin]]), bb_max(bb_min);
+	for (int i = _begin; i < _end; i++) {
+		bb_min.minimize(centers[_indices[i]]);
+		bb_max.maximize(centers[_indices[i]]);
 	}
+	Vec3f extent = bb_max - bb_min;
+	int axis = 0;
+	if (extent[1] > extent[axis]) axis = 1;
+	if (extent[2] > extent[axis]) axis = 2;
 
+	int mid = (_begin + _end) / 2;
+	std::nth_element(_indices.begin() + _begin, _indices.begin() + mid,
+		_indices.begin() + _end, CoordinateLess(centers, axis));
+	split(_indices, _begin, mid, _clusters);
+	split(_indices, mid, _end, _clusters);
+}
+
+
+template <class Kernel>
+bool ImplicitRBFT<Kernel>::Preconditioner::factorize(Subdomain& _sub) const
+{
+	const std::vector<Vec3f>& centers = rbf_.centers_;
+
+	// coincident centers have identical rows, keep one of them. The
+	// subdomain of the other one still updates its residual.
+	std::sort(_sub.indices.begin(), _sub.indices.end(), PositionLess(centers));
+	_sub.indices.erase(std::unique(_sub.indices.begin(), _sub.indices.end(),
+		SamePosition(centers)), _sub.indices.end());
+	int s = _sub.indices.size();
+
+	_sub.solver.resize(s + 4);
+	for (int row = 0; row < s; row++) {
+		const Vec3f& p = centers[_sub.indices[row]];
+		for (int col = 0; col <= row; col++) {
+			_sub.solver(row,col) = rbf_.kernel(p, centers[_sub.indices[col]]);
+		}
+		_sub.solver(s,row) = 1.0;
+		for (int k = 0; k < 3; k++) {
+			_sub.solver(s+1+k,row) = p[k];
+		}
+	}
+	return _sub.solver.factorize();
+}
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::Preconditioner::operator()(const gmmVector& _r, gmmVector& _z) const
+{
+	const std::vector<Vec3f>& centers = rbf_.centers_;
+	int i, n = centers.size();
+	int n_sub = subdomains_.size();
+
+	// the residuals that GMRES passes in have no affine part: the initial
+	// one is b - A 0 and the weights of every local interpolant satisfy
+	// the affine conditions, P^T w = 0
+	std::vector<double> r(_r.begin(), _r.begin() + n);
+	for (i = 0; i < n+4; i++) {
+		_z[i] = 0;
+	}
+
+	std::vector<double> x, cx, cy, cz;
+	for (int d = 0; d <= n_sub; d++) {
+		const Subdomain& sub = (d < n_sub) ? subdomains_[d] : coarse_;
+		int s = sub.indices.size();
+		if (s == 0) {
+			break;	// dropped coarse level
+		}
+
+		// interpolate the current residual on the subdomain
+		x.assign(s + 4, 0.0);
+		cx.resize(s);
+		cy.resize(s);
+		cz.resize(s);
+		for (int j = 0; j < s; j++) {
+			const Vec3f& c = centers[sub.indices[j]];
+			x[j] = r[sub.indices[j]];
+			cx[j] = c[0];
+			cy[j] = c[1];
+			cz[j] = c[2];
+		}
+		sub.solver.solve(x);
+		for (int j = 0; j < s; j++) {
+			_z[sub.indices[j]] += x[j];
+		}
+		for (int k = 0; k < 4; k++) {
+			_z[n+k] += x[s+k];
+		}
+		if (d == n_sub) {
+			break;
+		}
+
+		// subtract the interpolant from the residuals that are still needed
+#pragma omp parallel
+		{
+			std::vector<double> dist(s), phi(s);
+
+#pragma omp for schedule(dynamic, 64)
+			for (int row = 0; row < n; row++) {
+				if (last_[row] <= d) {
+					continue;
+				}
+				const Vec3f& p = centers[row];
+				distances(p, &cx[0], &cy[0], &cz[0], s, &dist[0]);
+				rbf_.rbf_.evaluate(&dist[0], s, &phi[0]);
+				double f = x[s] + x[s+1]*p[0] + x[s+2]*p[1] + x[s+3]*p[2];
+				for (int j = 0; j < s; j++) {
+					f += phi[j] * x[j];
+				}
+				r[row] -= f;
+			}
+		}
+	}
 }
 
 
 //-----------------------------------------------------------------------------
 
 
+template <class Kernel>
+double ImplicitRBFT<Kernel>::neighbor_fraction() const
+{
+	int n = (int)centers_.size();
+	if (n == 0) {
+		return 0;
+	}
+
+	// every stride-th row is enough for an estimate
+	int stride = std::max(1, n / NEIGHBOR_SAMPLES);
+	size_t count = 0, rows = 0;
+	std::vector<int> neighbors;
+	for (int row = 0; row < n; row += stride, rows++) {
+		tree_.radius_query(centers_[row], rbf_.support(), neighbors);
+		count += neighbors.size();
+	}
+	return (double)count / rows / n;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::fit_sparse(const std::vector<float>& _vals)
+{
+	int n = centers_.size();
+
+	// only centers within the kernel's support give non-zero entries
+	std::cout << "Filling the sparse matrix" << std::endl << std::flush;
+
+	gmmSparseMatrix M(n,n);
+	std::vector<int> neighbors;
+	for (int row = 0; row < n; row++) {
+		tree_.radius_query(centers_[row], rbf_.support(), neighbors);
+		for (unsigned int i = 0; i < neighbors.size(); i++) {
+			int col = neighbors[i];
+			double k = kernel(centers_[row], centers_[col]);
+			if (k != 0) {
+				M(row,col) = k;
+			}
+		}
+	}
+
+	gmmCsrMatrix A;
+	A.init_with(M);
+	std::cout << gmm::nnz(A) << " non-zeros ("
+		<< (double)gmm::nnz(A) / n << " per row)" << std::endl << std::flush;
+
+	gmmVector B(n);
+	for (unsigned int i = 0; i < B.size(); i++) {
+		B[i] = _vals[i];
+	}
+	gmmVector X(n, 0.0);
+
+	std::cout << "Solving the sparse linear system" << std::endl << std::flush;
+	solve_sparse_linear_system(A, B, X);
+
+	weights_.assign(X.begin(), X.end());
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+template <class Solver>
 void
-	ImplicitRBF::solve_linear_system( gmmMatrix& _M, 
-	gmmVector& _b, 
+	ImplicitRBFT<Kernel>::solve_linear_system( Solver& _M, 
 	gmmVector& _x)
 {
-	// solve linear system by gmm's LU factorization
-	unsigned int N = _b.size();
-	_x.resize(N);
-	std::vector< size_t >  ipvt(N);
-	gmm::lu_factor( _M, ipvt );
-	gmm::lu_solve( _M, ipvt, _x, _b );
+	// symmetric indefinite LDL^T factorization, the matrix is overwritten
+	converged_ = _M.factorize();
+	if (!converged_) {
+		std::cerr << "The RBF matrix is singular" << std::endl;
+	}
+	_M.solve(_x);
 }
 
 
 //-----------------------------------------------------------------------------
 
 
-float ImplicitRBF::operator()(const Vec3f& _p) const
+template <class Kernel>
+void
+	ImplicitRBFT<Kernel>::solve_sparse_linear_system( const gmmCsrMatrix& _A, 
+	const gmmVector& _b, 
+	gmmVector& _x)
 {
+	// the matrix is not positive definite in general, use ILUT-preconditioned
+	// GMRES instead of conjugate gradients
+	gmm::ilut_precond< gmmCsrMatrix > P(_A, 20, 1e-6);
+	gmm::iteration iter(1e-8);
+	iter.set_maxiter(10 * _b.size());
+	gmm::gmres(_A, _x, _b, P, 50, iter);
+
+	// max. norm of the residual relative to the right hand side, as for
+	// the dense solvers
+	gmmVector r(_b.size());
+	gmm::mult(_A, _x, r);
+	double r_norm = 0, b_norm = 0;
+	for (unsigned int i = 0; i < r.size(); i++) {
+		r_norm = std::max(r_norm, std::fabs(r[i] - _b[i]));
+		b_norm = std::max(b_norm, std::fabs(_b[i]));
+	}
+	residual_ = b_norm > 0 ? r_norm / b_norm : r_norm;
+	converged_ = iter.converged();
+
+	if (!converged_) {
+		std::cerr << "GMRES did not converge after " 
+			<< iter.get_iteration() << " iterations, relative residual "
+			<< residual_ << std::endl;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::use_treecode(double _tolerance)
+{
+	if (_tolerance <= 0 || !Kernel::TREECODE) {
+		treecode_ = TriharmonicTreecode();
+		return;
+	}
+
+	treecode_.build(centers_);
+	treecode_.set_weights(weights_);
+	treecode_.set_tolerance(_tolerance);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Kernel>
+float ImplicitRBFT<Kernel>::operator()(const Vec3f& _p) const
+{
+	if (!treecode_.empty()) {
+		return treecode_(_p) + affine(_p);
+	}
+
 	std::vector<Vec3f>::const_iterator  
 		c_it(centers_.begin()),
 		c_end(centers_.end());
@@ -89,7 +966,16 @@ float ImplicitRBF::operator()(const Vec3f& _p) const
 	std::vector<double>::const_iterator   
 		w_it(weights_.begin());
 
-	double f(0);
+	double f(affine(_p));
+
+	// compact support: only the centers around _p contribute
+	if (rbf_.support() > 0) {
+		std::vector<int> neighbors;
+		tree_.radius_query(_p, rbf_.support(), neighbors);
+		for (unsigned int i = 0; i < neighbors.size(); i++)
+			f += weights_[neighbors[i]] * kernel(centers_[neighbors[i]], _p);
+		return f;
+	}
 
 	for (; c_it!=c_end; ++c_it, ++w_it)
 		f += *w_it * kernel(*c_it, _p);
@@ -98,4 +984,79 @@ float ImplicitRBF::operator()(const Vec3f& _p) const
 }
 
 
+
+//-----------------------------------------------------------------------------
+
+
+
+
+template <class Kernel>
+void ImplicitRBFT<Kernel>::operator()(const float* _x, const float* _y, const float* _z,
+							 int _n, float* _values) const
+{
+	int i;
+	if (_n <= 0) {
+		return;
+	}
+
+	// the treecode evaluates point by point
+	if (!treecode_.empty()) {
+		for (i = 0; i < _n; i++) {
+			Vec3f p(_x[i], _y[i], _z[i]);
+			_values[i] = treecode_(p) + affine(p);
+		}
+		return;
+	}
+
+	// distances and kernels in double precision like kernel(), so that the
+	// batch and the single-point evaluation give the same values
+	std::vector<double> dist, phi;
+
+	// compact support: evaluate the kernels of each point's neighbors at once
+	if (rbf_.support() > 0) {
+		std::vector<int> neighbors;
+		for (i = 0; i < _n; i++) {
+			Vec3f p(_x[i], _y[i], _z[i]);
+			tree_.radius_query(p, rbf_.support(), neighbors);
+			int m = (int)neighbors.size();
+			dist.resize(m+1);
+			phi.resize(m+1);
+			for (int j = 0; j < m; j++)
+				dist[j] = (Vec3d(p) - Vec3d(centers_[neighbors[j]])).norm();
+			rbf_.evaluate(&dist[0], m, &phi[0]);
+
+			double f(affine(p));
+			for (int j = 0; j < m; j++)
+				f += weights_[neighbors[j]] * phi[j];
+			_values[i] = (float)f;
+		}
+		return;
+	}
+
+	// global support: loop over the centers, vectorized over the points
+	std::vector<double> x(_x, _x+_n), y(_y, _y+_n), z(_z, _z+_n), f(_n);
+	for (i = 0; i < _n; i++)
+		f[i] = affine(Vec3f(_x[i], _y[i], _z[i]));
+	dist.resize(_n);
+	phi.resize(_n);
+	for (unsigned int c = 0; c < centers_.size(); c++) {
+		distances(centers_[c], &x[0], &y[0], &z[0], _n, &dist[0]);
+		rbf_.evaluate(&dist[0], _n, &phi[0]);
+
+		const double w = weights_[c];
+		for (i = 0; i < _n; i++)
+			f[i] += w * phi[i];
+	}
+	for (i = 0; i < _n; i++)
+		_values[i] = (float)f[i];
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template class ImplicitRBFT<TriharmonicRbf>;
+template class ImplicitRBFT<CubicBSplineRbf>;
+
+
 //=============================================================================
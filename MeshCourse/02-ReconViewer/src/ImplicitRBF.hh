@@ -11,49 +11,237 @@
 #include <OpenMesh/Core/Geometry/VectorT.hh>
 #include <vector>
 #include <gmm.h>
+#include <IsoEx/Math/LDLTSolverT.hh>
 #include "Implicit.h"
 #include "RBF.h"
+#include "KdTree.hh"
+#include "TriharmonicTreecode.hh"
 
 //=============================================================================
 
 
-class ImplicitRBF : Implicit
+// how ImplicitRBFT solves for the weights of kernels with global support
+enum RbfSolver
+{
+	RBF_DENSE,			// LDL^T factorization in double precision
+	RBF_DENSE_SINGLE,	// in single precision with iterative refinement
+	RBF_MATRIX_FREE		// GMRES with matrix-free products, O(n) memory
+};
+
+
+// RBF fit to on- and off-surface constraints. The class is a template on the
+// kernel (see RBF.h), the kernel calls in the fitting and evaluation loops are
+// resolved at compile time. Instantiated for TriharmonicRbf and
+// CubicBSplineRbf in ImplicitRBF.cc.
+template <class Kernel>
+class ImplicitRBFT : Implicit
 {
 public:
 	typedef OpenMesh::Vec3f					Vec3f;
 	typedef OpenMesh::Vec3d					Vec3d;
-	typedef gmm::dense_matrix<double>		gmmMatrix;
 	typedef std::vector<double>				gmmVector;
-	// fit RBF to given constraints
-	ImplicitRBF(const std::vector<Vec3f>& _points, const std::vector<Vec3f>& _normals, float& epsilon, RBF& _rbf = TriharmonicRbf());
+	typedef gmm::row_matrix< gmm::wsvector<double> >	gmmSparseMatrix;
+	typedef gmm::csr_matrix<double>			gmmCsrMatrix;
+	typedef IsoEx::Math::LDLTSolverT<double>	DenseSolver;
+	// fit RBF to given constraints. For _greedy_tolerance > 0 only a subset
+	// of the constraints is used as centers, see fit_greedy(). _solver
+	// selects the solver for kernels with global support, see fit_dense()
+	// and fit_matrix_free(). For _far_field_tolerance > 0 the matrix-free
+	// products use a treecode (Kernel::TREECODE only). The residual of the
+	// fit relative to epsilon is below the larger of this tolerance and
+	// FIT_TOLERANCE (1e-6) unless converged() is false.
+	ImplicitRBFT(const std::vector<Vec3f>& _points, const std::vector<Vec3f>& _normals, float& epsilon, const Kernel& _rbf = Kernel(),
+		double _greedy_tolerance = 0, RbfSolver _solver = RBF_DENSE,
+		double _far_field_tolerance = 0);
 	// evaluate RBF at position _p
 	float operator()(const Vec3f& _p) const;
 
+	// evaluate RBF at the _n points (_x[i],_y[i],_z[i])
+	void operator()(const float* _x, const float* _y, const float* _z,
+		int _n, float* _values) const;
+
+	// evaluate by a treecode with absolute error _tolerance (kernels with
+	// Kernel::TREECODE only), 0 switches back to direct evaluation
+	void use_treecode(double _tolerance);
+
+	// max. norm of the residual of the last fit relative to the right hand
+	// side
+	double residual() const { return residual_; }
+
+	// did the last fit succeed, i.e. did the matrix-free or sparse solver
+	// reach its tolerance, or was the dense matrix non-singular? The fit is
+	// unusable otherwise.
+	bool converged() const { return converged_; }
+
 private:
 
-	// evaluate basis function of RBF
+	// evaluate basis function of RBF. The system matrix needs double
+	// precision: its entries differ by tiny amounts between nearby centers.
 	double kernel(const Vec3f& _c, const Vec3f& _x) const
 	{
-		double r = (_x-_c).norm();
-		return rbf_(r);
-	} 
-
-
+		return rbf_((Vec3d(_x)-Vec3d(_c)).norm());
+	}
+
+
+
+	// fit weights_ for the current centers_ to the values _vals, with
+	// _affine also affine_ (global kernels only, always for RBF_MATRIX_FREE).
+	// Compactly supported kernels use fit_sparse() unless their support
+	// covers SPARSE_FRACTION (see ImplicitRBF.cc) of the centers or more,
+	// then fit_dense() without affine part.
+	void fit(const std::vector<float>& _vals, bool _affine = false);
+
+	// greedy center selection: starting from a random subset of the
+	// constraints, fit, add the constraints with the largest residuals as
+	// centers and refit until all residuals are below _tolerance. Global
+	// kernels get an affine term, without it the fits of a subset are
+	// unstable.
+	void fit_greedy(const std::vector<Vec3f>& _constraints,
+		const std::vector<float>& _vals, double _tolerance);
+
+	// fit weights_ with a dense matrix (kernels with global support). In
+	// single precision the float factorization is followed by iterative
+	// refinement with residuals in double precision; if that does not
+	// converge the system is solved in double precision.
+	void fit_dense(const std::vector<float>& _vals, bool _affine);
+
+	// fill the lower triangle of the symmetric system matrix
+	template <class Matrix>
+	void fill_matrix(Matrix& _M, bool _affine) const;
+
+	// _r = _b - A * _x for the system matrix A, which is not stored but
+	// evaluated in double precision. Returns the max. norm of _r.
+	double residual(const gmmVector& _b, const gmmVector& _x, gmmVector& _r,
+		bool _affine) const;
+
+	// _y = A * _x, the entries of A are computed on the fly from centers_,
+	// in parallel over tiles of rows and columns
+	void multiply(const gmmVector& _x, gmmVector& _y, bool _affine) const;
+
+	// fit weights_ and affine_ by GMRES without storing the matrix. The
+	// products are computed by multiply() or, for far_field_tolerance_ > 0,
+	// by a treecode; the solution is then corrected by solves for the exact
+	// residual until it is below max(far_field_tolerance_, FIT_TOLERANCE).
+	// The fit always has an affine part, the preconditioner needs it.
+	void fit_matrix_free(const std::vector<float>& _vals);
+
+	// y = A x for fit_matrix_free()
+	class Product
+	{
+	public:
+		// _far_field_tolerance is the absolute error of the treecode
+		Product(const ImplicitRBFT& _rbf, double _far_field_tolerance);
+		void operator()(const gmmVector& _x, gmmVector& _y) const;
+		// change the absolute error of the treecode, if there is one
+		void set_tolerance(double _far_field_tolerance) const;
+	private:
+		const ImplicitRBFT&			rbf_;
+		mutable TriharmonicTreecode	far_field_;	// empty for direct products
+	};
+
+	// multiplicative Schwarz preconditioner with a coarse level for
+	// fit_matrix_free(), after Beatson, Light and Billings. The centers are
+	// split into spatial clusters, each is extended by its nearest
+	// neighbors to an overlapping subdomain. One application interpolates
+	// the residual on the subdomains in turn, each time updating the
+	// residual of all centers by the local interpolant, and finally on a
+	// coarse subset of all centers. Additive variants do not converge for
+	// the triharmonic kernel, the local interpolants grow away from their
+	// subdomain.
+	class Preconditioner
+	{
+	public:
+		Preconditioner(const ImplicitRBFT& _rbf);
+		void operator()(const gmmVector& _r, gmmVector& _z) const;
+	private:
+		struct Subdomain
+		{
+			std::vector<int>					indices;
+			IsoEx::Math::LDLTSolverT<double>	solver;	// local system with affine part
+		};
+		// split _indices[_begin,_end) at the median until clusters have at
+		// most CLUSTER_SIZE centers, appends their ranges to _clusters
+		void split(std::vector<int>& _indices, int _begin, int _end,
+			std::vector< std::pair<int,int> >& _clusters) const;
+		// set up and factorize the local system of _sub.indices. Coincident
+		// centers, e.g. duplicate samples, are removed from _sub.indices
+		// first. Returns false if the system is still singular.
+		bool factorize(Subdomain& _sub) const;
+	private:
+		const ImplicitRBFT&		rbf_;
+		std::vector<Subdomain>	subdomains_;
+		Subdomain				coarse_;
+		std::vector<int>		last_;	// last subdomain that contains a center,
+										// the coarse level counts as the last one
+	};
+
+	// the affine part of the RBF at _p
+	double affine(const Vec3f& _p) const
+	{
+		return affine_[0] + affine_[1]*_p[0] + affine_[2]*_p[1] + affine_[3]*_p[2];
+	}
+
+	// average fraction of the centers within the support of a center,
+	// estimated from NEIGHBOR_SAMPLES rows (compactly supported kernels,
+	// needs tree_)
+	double neighbor_fraction() const;
+
+	// fit weights_ with a sparse matrix (compactly supported kernels,
+	// needs tree_)
+	void fit_sparse(const std::vector<float>& _vals);
+
+	// solve the dense symmetric linear system _A * _x = _b, _x holds _b on
+	// input. _A is overwritten by its factorization. converged_ is false if
+	// _A is singular.
+	template <class Solver>
+	void solve_linear_system( Solver& _A, 
+		gmmVector& _x );
 
-	// solve linear system _A * _x = _b
-	void solve_linear_system( gmmMatrix& _A, 
-		gmmVector& _b, 
+	// solve sparse linear system _A * _x = _b iteratively, sets residual_
+	// and converged_
+	void solve_sparse_linear_system( const gmmCsrMatrix& _A, 
+		const gmmVector& _b, 
 		gmmVector& _x );
 
 private:
 
+	// iterative refinement of single precision solves and the corrections
+	// of fit_matrix_free() take at most this many steps, see also
+	// REFINEMENT_TOLERANCE and FIT_TOLERANCE in ImplicitRBF.cc
+	enum { MAX_REFINEMENT_STEPS = 30 };
+
+	// GMRES of fit_matrix_free(), see also GMRES_TOLERANCE
+	enum { GMRES_RESTART = 50, MAX_GMRES_ITERATIONS = 1000 };
+
+	// clusters of the Schwarz preconditioner have at most CLUSTER_SIZE
+	// centers, their subdomains add the SUBDOMAIN_SIZE nearest neighbors of
+	// the centroid, the coarse level has COARSE_SIZE centers
+	enum { CLUSTER_SIZE = 128, SUBDOMAIN_SIZE = 256, COARSE_SIZE = 256 };
+
+	// columns of the tiles of multiply()
+	enum { TILE_SIZE = 1024 };
+
+	// rows sampled by neighbor_fraction()
+	enum { NEIGHBOR_SAMPLES = 256 };
+
 	std::vector<Vec3f>		centers_;
 	std::vector<double>		weights_;
+	double					affine_[4];	// 0 unless fitted greedily or matrix-free
+	RbfSolver				solver_;
+	double					far_field_tolerance_;
+	double					residual_;
+	bool					converged_;
 	float					epsilon_;
-	RBF&					rbf_;
+	Kernel					rbf_;
+	KdTree					tree_;		// over centers_, compact support only
+	TriharmonicTreecode		treecode_;	// see use_treecode()
 };
 
 
+// the default reconstruction
+typedef ImplicitRBFT<TriharmonicRbf> ImplicitRBF;
+
+
 //=============================================================================
 #endif // RBF_HH defined
 //=============================================================================
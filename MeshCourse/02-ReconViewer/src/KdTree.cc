@@ -0,0 +1,263 @@
+//=============================================================================
+
+
+//=============================================================================
+
+
+#include "KdTree.hh"
+#include <algorithm>
+#include <float.h>
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+// orders points along one coordinate axis
+struct AxisLess
+{
+	AxisLess(const std::vector<OpenMesh::Vec3f>& _points, int _axis)
+		: points_(_points), axis_(_axis) {}
+
+	bool operator()(int _i, int _j) const
+	{
+		return points_[_i][axis_] < points_[_j][axis_];
+	}
+
+	const std::vector<OpenMesh::Vec3f>&	points_;
+	int									axis_;
+};
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KdTree::build(const std::vector<Vec3f>& _points)
+{
+	int n = (int)_points.size();
+
+	points_ = _points;
+	index_.resize(n);
+	for (int i = 0; i < n; i++) {
+		index_[i] = i;
+	}
+	axis_.assign(n, 0);
+
+	// split the top levels until there are enough independent subtrees
+	std::vector< std::pair<int,int> > ranges(1, std::make_pair(0, n)), next;
+	for (int level = 0; level < PARALLEL_LEVELS; level++)
+	{
+		next.clear();
+		for (unsigned int r = 0; r < ranges.size(); r++)
+		{
+			int mid = split(ranges[r].first, ranges[r].second);
+			if (mid >= 0) {
+				next.push_back(std::make_pair(ranges[r].first, mid));
+				next.push_back(std::make_pair(mid+1, ranges[r].second));
+			}
+		}
+		ranges.swap(next);
+	}
+
+	int n_ranges = (int)ranges.size();
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int r = 0; r < n_ranges; r++) {
+		build(ranges[r].first, ranges[r].second);
+	}
+
+	// store the points in tree order for cache friendly traversal
+	for (int i = 0; i < n; i++) {
+		points_[i] = _points[index_[i]];
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KdTree::build(int _begin, int _end)
+{
+	int mid = split(_begin, _end);
+	if (mid >= 0) {
+		build(_begin, mid);
+		build(mid+1, _end);
+	}
+}
+
+
+int KdTree::split(int _begin, int _end)
+{
+	if (_end - _begin <= LEAF_SIZE) {
+		return -1;
+	}
+
+	// split along the axis of largest extent
+	Vec3f bb_min(points_[index_[_begin]]), bb_max(bb_min);
+	for (int i = _begin+1; i < _end; i++) {
+		bb_min.minimize(points_[index_[i]]);
+		bb_max.maximize(points_[index_[i]]);
+	}
+	Vec3f extent = bb_max - bb_min;
+	int axis = 0;
+	if (extent[1] > extent[axis]) axis = 1;
+	if (extent[2] > extent[axis]) axis = 2;
+
+	int mid = (_begin + _end) / 2;
+	std::nth_element(index_.begin()+_begin, index_.begin()+mid,
+		index_.begin()+_end, AxisLess(points_, axis));
+	axis_[mid] = (unsigned char)axis;
+
+	return mid;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KdTree::radius_query(const Vec3f& _p, float _radius,
+						  std::vector<int>& _indices) const
+{
+	_indices.clear();
+	radius_query(0, size(), _p, _radius*_radius, _indices);
+}
+
+
+void KdTree::radius_query(int _begin, int _end, const Vec3f& _p,
+						  float _sqr_radius, std::vector<int>& _indices) const
+{
+	if (_end - _begin <= LEAF_SIZE) {
+		for (int i = _begin; i < _end; i++) {
+			if ((points_[i] - _p).sqrnorm() <= _sqr_radius) {
+				_indices.push_back(index_[i]);
+			}
+		}
+		return;
+	}
+
+	int mid = (_begin + _end) / 2;
+	if ((points_[mid] - _p).sqrnorm() <= _sqr_radius) {
+		_indices.push_back(index_[mid]);
+	}
+
+	float d = _p[axis_[mid]] - points_[mid][axis_[mid]];
+	if (d <= 0 || d*d <= _sqr_radius) {
+		radius_query(_begin, mid, _p, _sqr_radius, _indices);
+	}
+	if (d >= 0 || d*d <= _sqr_radius) {
+		radius_query(mid+1, _end, _p, _sqr_radius, _indices);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int KdTree::nearest(const Vec3f& _p) const
+{
+	int   best(-1);
+	float sqr_dist(FLT_MAX);
+	nearest(0, size(), _p, best, sqr_dist);
+	return (best < 0) ? -1 : index_[best];
+}
+
+
+void KdTree::nearest(int _begin, int _end, const Vec3f& _p,
+					 int& _best, float& _sqr_dist) const
+{
+	if (_end - _begin <= LEAF_SIZE) {
+		for (int i = _begin; i < _end; i++) {
+			float d = (points_[i] - _p).sqrnorm();
+			if (d < _sqr_dist) {
+				_sqr_dist = d;
+				_best     = i;
+			}
+		}
+		return;
+	}
+
+	int mid = (_begin + _end) / 2;
+	float d = (points_[mid] - _p).sqrnorm();
+	if (d < _sqr_dist) {
+		_sqr_dist = d;
+		_best     = mid;
+	}
+
+	// descend into the half containing _p first
+	d = _p[axis_[mid]] - points_[mid][axis_[mid]];
+	if (d <= 0) {
+		nearest(_begin, mid, _p, _best, _sqr_dist);
+		if (d*d < _sqr_dist) nearest(mid+1, _end, _p, _best, _sqr_dist);
+	}
+	else {
+		nearest(mid+1, _end, _p, _best, _sqr_dist);
+		if (d*d < _sqr_dist) nearest(_begin, mid, _p, _best, _sqr_dist);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void KdTree::knn_query(const Vec3f& _p, int _k, std::vector<int>& _indices) const
+{
+	// max-heap of the _k best candidates found so far
+	std::vector<Candidate> heap;
+	heap.reserve(_k+1);
+	if (_k > 0) {
+		knn_query(0, size(), _p, _k, heap);
+	}
+
+	std::sort_heap(heap.begin(), heap.end());
+	_indices.resize(heap.size());
+	for (unsigned int i = 0; i < heap.size(); i++) {
+		_indices[i] = index_[heap[i].second];
+	}
+}
+
+
+void KdTree::knn_query(int _begin, int _end, const Vec3f& _p, int _k,
+					   std::vector<Candidate>& _heap) const
+{
+	if (_end - _begin <= LEAF_SIZE) {
+		for (int i = _begin; i < _end; i++) {
+			insert(Candidate((points_[i] - _p).sqrnorm(), i), _k, _heap);
+		}
+		return;
+	}
+
+	int mid = (_begin + _end) / 2;
+	insert(Candidate((points_[mid] - _p).sqrnorm(), mid), _k, _heap);
+
+	// descend into the half containing _p first, visit the other half only
+	// if the splitting plane is closer than the current k-th neighbor
+	float d = _p[axis_[mid]] - points_[mid][axis_[mid]];
+	if (d <= 0) {
+		knn_query(_begin, mid, _p, _k, _heap);
+		if ((int)_heap.size() < _k || d*d < _heap.front().first)
+			knn_query(mid+1, _end, _p, _k, _heap);
+	}
+	else {
+		knn_query(mid+1, _end, _p, _k, _heap);
+		if ((int)_heap.size() < _k || d*d < _heap.front().first)
+			knn_query(_begin, mid, _p, _k, _heap);
+	}
+}
+
+
+void KdTree::insert(const Candidate& _c, int _k, std::vector<Candidate>& _heap)
+{
+	if ((int)_heap.size() < _k) {
+		_heap.push_back(_c);
+		std::push_heap(_heap.begin(), _heap.end());
+	}
+	else if (_c < _heap.front()) {
+		std::pop_heap(_heap.begin(), _heap.end());
+		_heap.back() = _c;
+		std::push_heap(_heap.begin(), _heap.end());
+	}
+}
+
+//=============================================================================
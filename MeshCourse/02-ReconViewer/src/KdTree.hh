@@ -0,0 +1,90 @@
+//=============================================================================
+
+
+//=============================================================================
+
+
+#ifndef KDTREE_HH
+#define KDTREE_HH
+
+
+//=============================================================================
+
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <vector>
+
+//=============================================================================
+
+
+// Balanced 3D kd-tree over a point set, used for the neighborhood queries of
+// the reconstruction methods. The tree is stored implicitly: the points are
+// permuted such that every range [begin,end) is split at its median, so no
+// nodes have to be allocated. Construction is parallelized by OpenMP, the
+// resulting tree does not depend on the number of threads.
+class KdTree
+{
+public:
+
+	typedef OpenMesh::Vec3f Vec3f;
+
+	KdTree() {}
+	KdTree(const std::vector<Vec3f>& _points) { build(_points); }
+
+	// (re-)build the tree for the given points
+	void build(const std::vector<Vec3f>& _points);
+
+	// number of points in the tree
+	int size() const { return (int)points_.size(); }
+
+	// collect the indices of all points with distance <= _radius to _p
+	void radius_query(const Vec3f& _p, float _radius,
+		std::vector<int>& _indices) const;
+
+	// index of the point closest to _p, -1 for an empty tree
+	int nearest(const Vec3f& _p) const;
+
+	// collect the indices of the _k points closest to _p, sorted by distance
+	void knn_query(const Vec3f& _p, int _k, std::vector<int>& _indices) const;
+
+
+private:
+
+	void build(int _begin, int _end);
+
+	// partition [_begin,_end) at its median, returns -1 for leaf ranges
+	int split(int _begin, int _end);
+
+	void radius_query(int _begin, int _end, const Vec3f& _p, float _sqr_radius,
+		std::vector<int>& _indices) const;
+
+	void nearest(int _begin, int _end, const Vec3f& _p,
+		int& _best, float& _sqr_dist) const;
+
+	typedef std::pair<float, int> Candidate;	// squared distance, position
+
+	void knn_query(int _begin, int _end, const Vec3f& _p, int _k,
+		std::vector<Candidate>& _heap) const;
+
+	static void insert(const Candidate& _c, int _k,
+		std::vector<Candidate>& _heap);
+
+private:
+
+	// ranges with at most this many points are not split any further
+	enum { LEAF_SIZE = 8 };
+
+	// the top levels are split serially, the resulting 2^PARALLEL_LEVELS
+	// subtrees are built in parallel
+	enum { PARALLEL_LEVELS = 6 };
+
+	std::vector<Vec3f>			points_;	// points in tree order
+	std::vector<int>			index_;		// original index of points_[i]
+	std::vector<unsigned char>	axis_;		// split axis of range with median i
+};
+
+
+//=============================================================================
+#endif // KDTREE_HH defined
+//=============================================================================
+
@@ -0,0 +1,315 @@
+//=============================================================================
+
+
+#include "NormalEstimation.hh"
+#include "KdTree.hh"
+#include <algorithm>
+#include <cmath>
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+typedef OpenMesh::Vec3f Vec3f;
+
+
+// eigenvector of the smallest eigenvalue of the symmetric 3x3 matrix _a,
+// cyclic Jacobi rotations (_a is destroyed)
+Vec3f smallest_eigenvector(double _a[3][3])
+{
+	double v[3][3] = { {1,0,0}, {0,1,0}, {0,0,1} };
+
+	for (int sweep = 0; sweep < 16; sweep++) {
+		double off = _a[0][1]*_a[0][1] + _a[0][2]*_a[0][2] + _a[1][2]*_a[1][2];
+		double diag = _a[0][0]*_a[0][0] + _a[1][1]*_a[1][1] + _a[2][2]*_a[2][2];
+		if (off <= 1e-30 * diag) {
+			break;
+		}
+
+		for (int p = 0; p < 2; p++) {
+			for (int q = p+1; q < 3; q++) {
+				if (_a[p][q] == 0.0) {
+					continue;
+				}
+
+				// rotation annihilating _a[p][q]
+				double theta = (_a[q][q] - _a[p][p]) / (2.0 * _a[p][q]);
+				double t = (theta >= 0 ? 1.0 : -1.0) /
+					(std::fabs(theta) + std::sqrt(theta*theta + 1.0));
+				double c = 1.0 / std::sqrt(t*t + 1.0), s = t * c;
+
+				for (int k = 0; k < 3; k++) {
+					double akp = _a[k][p], akq = _a[k][q];
+					_a[k][p] = c*akp - s*akq;
+					_a[k][q] = s*akp + c*akq;
+				}
+				for (int k = 0; k < 3; k++) {
+					double apk = _a[p][k], aqk = _a[q][k];
+					_a[p][k] = c*apk - s*aqk;
+					_a[q][k] = s*apk + c*aqk;
+				}
+				for (int k = 0; k < 3; k++) {
+					double vkp = v[k][p], vkq = v[k][q];
+					v[k][p] = c*vkp - s*vkq;
+					v[k][q] = s*vkp + c*vkq;
+				}
+			}
+		}
+	}
+
+	int m = 0;
+	if (_a[1][1] < _a[m][m]) m = 1;
+	if (_a[2][2] < _a[m][m]) m = 2;
+
+	Vec3f n((float)v[0][m], (float)v[1][m], (float)v[2][m]);
+	float l = n.norm();
+	return (l > 0) ? n / l : Vec3f(0, 0, 1);
+}
+
+
+// edge of the neighborhood graph
+struct Edge
+{
+	float	weight;
+	int		i, j;
+
+	bool operator<(const Edge& _e) const { return weight < _e.weight; }
+};
+
+
+// disjoint sets with union by size and path halving
+class UnionFind
+{
+public:
+
+	UnionFind(int _n) : parent_(_n), size_(_n, 1)
+	{
+		for (int i = 0; i < _n; i++) {
+			parent_[i] = i;
+		}
+	}
+
+	int find(int _i)
+	{
+		while (parent_[_i] != _i) {
+			parent_[_i] = parent_[parent_[_i]];
+			_i = parent_[_i];
+		}
+		return _i;
+	}
+
+	// returns false if _i and _j already are in the same set
+	bool unite(int _i, int _j)
+	{
+		_i = find(_i);
+		_j = find(_j);
+		if (_i == _j) {
+			return false;
+		}
+		if (size_[_i] < size_[_j]) {
+			std::swap(_i, _j);
+		}
+		parent_[_j] = _i;
+		size_[_i] += size_[_j];
+		return true;
+	}
+
+private:
+
+	std::vector<int>	parent_;
+	std::vector<int>	size_;
+};
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+
+
+int estimate_normals(const std::vector<Vec3f>& _points, int _k,
+	std::vector<Vec3f>& _normals)
+{
+	const int n = (int)_points.size();
+	_normals.resize(n);
+	if (n == 0) {
+		return 0;
+	}
+	if (n == 1) {
+		// no neighborhood to fit a plane to, a single component
+		_normals[0] = Vec3f(0, 0, 1);
+		return 1;
+	}
+	const int k = std::min(std::max(_k, 2), n);
+
+
+	// 1) neighborhoods (including the point itself) and PCA normals
+
+	KdTree tree(_points);
+	std::vector<int> neighbors((size_t)n * k);
+
+#pragma omp parallel
+	{
+		std::vector<int> nbh;
+
+#pragma omp for schedule(dynamic, 256)
+		for (int i = 0; i < n; i++) {
+			tree.knn_query(_points[i], k, nbh);
+			const int m = (int)nbh.size();
+
+			// rows with fewer than k neighbors are padded with i itself,
+			// self edges are skipped below
+			std::copy(nbh.begin(), nbh.end(), neighbors.begin() + (size_t)i*k);
+			std::fill(neighbors.begin() + (size_t)i*k + m,
+				neighbors.begin() + (size_t)(i+1)*k, i);
+
+			Vec3f c(0, 0, 0);
+			for (int j = 0; j < m; j++) {
+				c += _points[nbh[j]];
+			}
+			c /= (float)std::max(m, 1);
+
+			double a[3][3] = { {0,0,0}, {0,0,0}, {0,0,0} };
+			for (int j = 0; j < m; j++) {
+				Vec3f d = _points[nbh[j]] - c;
+				for (int r = 0; r < 3; r++) {
+					for (int s = r; s < 3; s++) {
+						a[r][s] += (double)d[r] * d[s];
+					}
+				}
+			}
+			a[1][0] = a[0][1];
+			a[2][0] = a[0][2];
+			a[2][1] = a[1][2];
+
+			_normals[i] = smallest_eigenvector(a);
+		}
+	}
+
+
+	// 2) edges of the symmetric kNN graph, every edge is stored once: (i,j)
+	// is kept if j > i, or if j < i and i is not among j's neighbors
+
+	const int* nb = &neighbors[0];
+	std::vector<size_t> offset(n+1, 0);
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++) {
+		size_t count = 0;
+		for (int l = 0; l < k; l++) {
+			int j = nb[(size_t)i*k + l];
+			if (j > i || (j < i && std::find(nb + (size_t)j*k,
+				nb + (size_t)(j+1)*k, i) == nb + (size_t)(j+1)*k)) {
+				count++;
+			}
+		}
+		offset[i+1] = count;
+	}
+	for (int i = 0; i < n; i++) {
+		offset[i+1] += offset[i];
+	}
+
+	std::vector<Edge> edges(offset[n]);
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++) {
+		size_t e = offset[i];
+		for (int l = 0; l < k; l++) {
+			int j = nb[(size_t)i*k + l];
+			if (j > i || (j < i && std::find(nb + (size_t)j*k,
+				nb + (size_t)(j+1)*k, i) == nb + (size_t)(j+1)*k)) {
+				edges[e].weight = 1.0f - std::fabs(_normals[i] | _normals[j]);
+				edges[e].i = i;
+				edges[e].j = j;
+				e++;
+			}
+		}
+	}
+
+	std::vector<int>().swap(neighbors);
+	std::vector<size_t>().swap(offset);
+
+
+	// 3) minimum spanning forest (Kruskal)
+
+	std::sort(edges.begin(), edges.end());
+
+	UnionFind sets(n);
+	std::vector<int> tree_edges;
+	tree_edges.reserve(2 * (size_t)(n-1));
+	for (size_t e = 0; e < edges.size() && (int)tree_edges.size() < 2*(n-1); e++) {
+		if (sets.unite(edges[e].i, edges[e].j)) {
+			tree_edges.push_back(edges[e].i);
+			tree_edges.push_back(edges[e].j);
+		}
+	}
+	std::vector<Edge>().swap(edges);
+
+	// adjacency of the forest in compressed rows
+	std::vector<int> first(n+1, 0), adjacent(tree_edges.size());
+	for (size_t e = 0; e < tree_edges.size(); e++) {
+		first[tree_edges[e]+1]++;
+	}
+	for (int i = 0; i < n; i++) {
+		first[i+1] += first[i];
+	}
+	{
+		std::vector<int> fill(first.begin(), first.end() - 1);
+		for (size_t e = 0; e < tree_edges.size(); e += 2) {
+			adjacent[fill[tree_edges[e]]++]   = tree_edges[e+1];
+			adjacent[fill[tree_edges[e+1]]++] = tree_edges[e];
+		}
+	}
+	std::vector<int>().swap(tree_edges);
+
+
+	// 4) propagate the orientation from the topmost point of each component
+
+	std::vector<int> root(n, -1);
+	for (int i = 0; i < n; i++) {
+		int r = sets.find(i);
+		if (root[r] < 0 || _points[i][2] > _points[root[r]][2]) {
+			root[r] = i;
+		}
+	}
+
+	std::vector<char> visited(n, 0);
+	std::vector<int> queue;
+	queue.reserve(n);
+	int n_components = 0;
+
+	for (int r = 0; r < n; r++) {
+		if (root[r] < 0) {
+			continue;
+		}
+		n_components++;
+
+		int s = root[r];
+		if (_normals[s][2] < 0) {
+			_normals[s] = -_normals[s];
+		}
+		visited[s] = 1;
+		queue.clear();
+		queue.push_back(s);
+
+		for (size_t q = 0; q < queue.size(); q++) {
+			int i = queue[q];
+			for (int a = first[i]; a < first[i+1]; a++) {
+				int j = adjacent[a];
+				if (!visited[j]) {
+					if ((_normals[i] | _normals[j]) < 0) {
+						_normals[j] = -_normals[j];
+					}
+					visited[j] = 1;
+					queue.push_back(j);
+				}
+			}
+		}
+	}
+
+	return n_components;
+}
+
+
+//=============================================================================
@@ -0,0 +1,38 @@
+//=============================================================================
+
+
+#ifndef NORMALESTIMATION_HH
+#define NORMALESTIMATION_HH
+
+
+//=============================================================================
+
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <vector>
+
+//=============================================================================
+
+
+// Estimation of consistently oriented normals for a raw point cloud, after
+// Hoppe et al., "Surface reconstruction from unorganized points", 1992.
+//
+// The normal of every point is the eigenvector of the smallest eigenvalue of
+// the covariance matrix of its _k nearest neighbors. These neighborhoods are
+// computed in parallel and also define the graph over which the orientation
+// is propagated: its edges are weighted by 1 - |n_i . n_j|, so propagation
+// prefers nearly parallel normals, and the normals are flipped to agree with
+// their parent along a minimum spanning tree (Kruskal with union-find). In
+// every connected component the propagation starts at the point with the
+// largest z coordinate, whose normal is made to point to +z.
+//
+// The memory used is O(n _k). _normals is resized to the number of points;
+// the number of connected components of the neighborhood graph is returned,
+// values > 1 indicate that _k is too small for the sampling density.
+int estimate_normals(const std::vector<OpenMesh::Vec3f>& _points, int _k,
+	std::vector<OpenMesh::Vec3f>& _normals);
+
+
+//=============================================================================
+#endif // NORMALESTIMATION_HH defined
+//=============================================================================
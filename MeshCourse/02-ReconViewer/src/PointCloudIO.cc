@@ -0,0 +1,664 @@
+//=============================================================================
+
+
+#include "PointCloudIO.hh"
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+typedef OpenMesh::Vec3f Vec3f;
+
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+
+	MappedFile(const char* _filename) : data_(0), size_(0), open_(false)
+	{
+#ifdef _WIN32
+		mapping_ = 0;
+		file_ = CreateFileA(_filename, GENERIC_READ, FILE_SHARE_READ, 0,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+		if (file_ == INVALID_HANDLE_VALUE) {
+			return;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file_, &size)) {
+			return;
+		}
+		size_ = (size_t)size.QuadPart;
+		open_ = true;
+		if (size_ == 0) {
+			return;
+		}
+		mapping_ = CreateFileMapping(file_, 0, PAGE_READONLY, 0, 0, 0);
+		if (mapping_) {
+			data_ = (const char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+		}
+#else
+		fd_ = open(_filename, O_RDONLY);
+		if (fd_ < 0) {
+			return;
+		}
+		struct stat st;
+		if (fstat(fd_, &st) != 0) {
+			return;
+		}
+		size_ = (size_t)st.st_size;
+		open_ = true;
+		if (size_ == 0) {
+			return;
+		}
+		void* data = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+		if (data != MAP_FAILED) {
+			data_ = (const char*)data;
+			madvise(data, size_, MADV_SEQUENTIAL);
+		}
+#endif
+		open_ = (data_ != 0);
+	}
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (data_)    UnmapViewOfFile(data_);
+		if (mapping_) CloseHandle(mapping_);
+		if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+		if (data_)    munmap((void*)data_, size_);
+		if (fd_ >= 0) close(fd_);
+#endif
+	}
+
+	bool        is_open() const { return open_; }
+	const char* data()    const { return data_; }
+	size_t      size()    const { return size_; }
+
+private:
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char*  data_;
+	size_t       size_;
+	bool         open_;
+#ifdef _WIN32
+	HANDLE       file_, mapping_;
+#else
+	int          fd_;
+#endif
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+std::string extension(const char* _filename)
+{
+	std::string name(_filename);
+	std::string::size_type dot = name.rfind('.');
+	if (dot == std::string::npos) {
+		return std::string();
+	}
+	std::string ext = name.substr(dot+1);
+	for (unsigned int i = 0; i < ext.size(); i++) {
+		ext[i] = (char)tolower(ext[i]);
+	}
+	return ext;
+}
+
+
+//== ASCII .pts ===============================================================
+
+
+// parse a number at _p, skipping blanks but not line breaks. Returns 1 for
+// a number, 0 at the end of the line and -1 for anything else. Much faster
+// than strtod() and independent of the locale; the result may differ from
+// a correctly rounded one in the last bit.
+int parse_float(const char*& _p, const char* _end, float& _value)
+{
+	static const double pow10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	const char* p = _p;
+	while (p < _end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+		p++;
+	}
+	_p = p;
+	if (p == _end || *p == '\n') {
+		return 0;
+	}
+
+	bool negative = false;
+	if (*p == '-' || *p == '+') {
+		negative = (*p == '-');
+		p++;
+	}
+
+	// up to 19 significant digits fit into the mantissa
+	uint64_t mantissa = 0;
+	int exponent = 0, digits = 0, significant = 0;
+	for (; p < _end && *p >= '0' && *p <= '9'; p++, digits++) {
+		if (significant < 19) {
+			mantissa = 10*mantissa + (*p - '0');
+			if (mantissa) significant++;
+		}
+		else {
+			exponent++;
+		}
+	}
+	if (p < _end && *p == '.') {
+		for (p++; p < _end && *p >= '0' && *p <= '9'; p++, digits++) {
+			if (significant < 19) {
+				mantissa = 10*mantissa + (*p - '0');
+				if (mantissa) significant++;
+				exponent--;
+			}
+		}
+	}
+	if (!digits) {
+		_p = p;
+		return -1;
+	}
+
+	if (p < _end && (*p == 'e' || *p == 'E')) {
+		const char* q = p+1;
+		bool negative_exp = false;
+		if (q < _end && (*q == '-' || *q == '+')) {
+			negative_exp = (*q == '-');
+			q++;
+		}
+		if (q < _end && *q >= '0' && *q <= '9') {
+			int e = 0;
+			for (; q < _end && *q >= '0' && *q <= '9'; q++) {
+				if (e < 10000) e = 10*e + (*q - '0');
+			}
+			exponent += negative_exp ? -e : e;
+			p = q;
+		}
+	}
+
+	// the number has to end here
+	if (p < _end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+		_p = p;
+		return -1;
+	}
+
+	double value = (double)mantissa;
+	if (exponent >= 0 && exponent <= 22) {
+		value *= pow10[exponent];
+	}
+	else if (exponent < 0 && exponent >= -22) {
+		value /= pow10[-exponent];
+	}
+	else {
+		value *= pow(10.0, exponent);
+	}
+
+	_value = (float)(negative ? -value : value);
+	_p = p;
+	return 1;
+}
+
+
+// parse the lines of [_begin,_end) into _points/_normals starting at
+// index _first. Returns the number of points, counts lines with 6 numbers
+// in _n_normals and malformed lines in _n_bad. _first_bad is the index of
+// the first malformed line within the range, -1 if there is none.
+int parse_lines(const char* _begin, const char* _end, int _first,
+				std::vector<Vec3f>& _points, std::vector<Vec3f>& _normals,
+				int& _n_normals, int& _n_bad, int& _first_bad)
+{
+	const char* p = _begin;
+	int n_points = 0, n, result, line;
+	float v[6], x;
+
+	_n_normals = _n_bad = 0;
+	_first_bad = -1;
+	for (line = 0; p < _end; line++)
+	{
+		n = 0;
+		while ((result = parse_float(p, _end, x)) > 0) {
+			if (n < 6) v[n] = x;
+			n++;
+		}
+
+		// skip the rest of the line
+		if (result < 0) {
+			const char* eol = (const char*)memchr(p, '\n', _end - p);
+			p = eol ? eol : _end;
+		}
+		if (p < _end) {
+			p++;
+		}
+
+		if (result < 0 || (n != 0 && n != 3 && n != 6)) {
+			if (!_n_bad++) _first_bad = line;
+			continue;
+		}
+		if (n == 0) {
+			continue;
+		}
+
+		int i = _first + n_points++;
+		_points[i] = Vec3f(v[0], v[1], v[2]);
+		if (n == 6) {
+			_normals[i] = Vec3f(v[3], v[4], v[5]);
+			_n_normals++;
+		}
+	}
+
+	return n_points;
+}
+
+
+bool read_pts(const MappedFile& _file, const char* _filename,
+			  std::vector<Vec3f>& _points, std::vector<Vec3f>& _normals)
+{
+	const char* data = _file.data();
+	const size_t size = _file.size();
+
+	// chunks of whole lines, enough of them to balance the load
+	const int n_chunks = (int)std::min<size_t>(256, size / (1<<16) + 1);
+	std::vector<const char*> begin(n_chunks+1);
+	begin[0] = data;
+	begin[n_chunks] = data + size;
+	int c;
+	for (c = 1; c < n_chunks; c++) {
+		const char* p = data + size / n_chunks * c;
+		p = std::max(p, begin[c-1]);
+		const char* eol = (const char*)memchr(p, '\n', data + size - p);
+		begin[c] = eol ? eol+1 : data + size;
+	}
+
+	// number of lines per chunk, an upper bound of its number of points
+	std::vector<int> first(n_chunks+1, 0);
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (c = 0; c < n_chunks; c++)
+	{
+		int lines = 0;
+		for (const char* p = begin[c]; p < begin[c+1]; p++) {
+			p = (const char*)memchr(p, '\n', begin[c+1] - p);
+			if (!p) break;
+			lines++;
+		}
+		if (begin[c+1] > begin[c] && begin[c+1][-1] != '\n') {
+			lines++;
+		}
+		first[c+1] = lines;
+	}
+	for (c = 0; c < n_chunks; c++) {
+		first[c+1] += first[c];
+	}
+
+	_points.resize(first[n_chunks]);
+	_normals.resize(first[n_chunks]);
+
+	std::vector<int> n_points(n_chunks), n_normals(n_chunks), n_bad(n_chunks),
+		first_bad(n_chunks);
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (c = 0; c < n_chunks; c++) {
+		n_points[c] = parse_lines(begin[c], begin[c+1], first[c], _points,
+			_normals, n_normals[c], n_bad[c], first_bad[c]);
+	}
+
+	// remove the gaps left by empty and malformed lines, first[c] is the
+	// number of lines before chunk c
+	int n = 0, total_normals = 0, total_bad = 0, bad_line = 0;
+	for (c = 0; c < n_chunks; c++)
+	{
+		if (!total_bad && n_bad[c]) {
+			bad_line = first[c] + first_bad[c] + 1;
+		}
+		if (n != first[c]) {
+			std::copy(_points.begin() + first[c],
+				_points.begin() + first[c] + n_points[c], _points.begin() + n);
+			std::copy(_normals.begin() + first[c],
+				_normals.begin() + first[c] + n_points[c], _normals.begin() + n);
+		}
+		n += n_points[c];
+		total_normals += n_normals[c];
+		total_bad += n_bad[c];
+	}
+	_points.resize(n);
+	_normals.resize(n);
+
+	if (total_bad) {
+		std::cerr << _filename << ": skipped " << total_bad
+			<< " malformed lines, the first one is line " << bad_line
+			<< " (expected 3 or 6 numbers per line)" << std::endl;
+	}
+	if (total_normals != n) {
+		if (total_normals) {
+			std::cerr << _filename << ": only " << total_normals << " of " << n
+				<< " points have normals, ignoring them" << std::endl;
+		}
+		_normals.clear();
+	}
+
+	return true;
+}
+
+
+//== binary .ptsb =============================================================
+
+
+bool read_ptsb(const MappedFile& _file, const char* _filename,
+			   std::vector<Vec3f>& _points, std::vector<Vec3f>& _normals)
+{
+	const char* data = _file.data();
+	const size_t size = _file.size();
+	uint32_t flags;
+	uint64_t n;
+
+	if (size < 16 || memcmp(data, "PTSB", 4) != 0) {
+		std::cerr << _filename << ": not a PTSB file" << std::endl;
+		return false;
+	}
+	memcpy(&flags, data+4, 4);
+	memcpy(&n, data+8, 8);
+
+	const bool has_normals = (flags & 1) != 0;
+	if (n > (size - 16) / (has_normals ? 24 : 12)) {
+		std::cerr << _filename << ": file is truncated" << std::endl;
+		return false;
+	}
+
+	// Vec3f is a plain array of 3 floats
+	const size_t bytes = (size_t)n * sizeof(Vec3f);
+	_points.resize((size_t)n);
+	_normals.resize(has_normals ? (size_t)n : 0);
+	if (n) {
+		memcpy(&_points[0], data+16, bytes);
+		if (has_normals) {
+			memcpy(&_normals[0], data+16+bytes, bytes);
+		}
+	}
+
+	return true;
+}
+
+
+//== binary .ply ==============================================================
+
+
+// size of a PLY scalar type in bytes, 0 if unknown
+int ply_type_size(const std::string& _type)
+{
+	if (_type == "char"  || _type == "uchar"  || _type == "int8"    || _type == "uint8")   return 1;
+	if (_type == "short" || _type == "ushort" || _type == "int16"   || _type == "uint16")  return 2;
+	if (_type == "int"   || _type == "uint"   || _type == "int32"   || _type == "uint32" ||
+		_type == "float" || _type == "float32") return 4;
+	if (_type == "double" || _type == "float64") return 8;
+	return 0;
+}
+
+
+bool read_ply(const MappedFile& _file, const char* _filename,
+			  std::vector<Vec3f>& _points, std::vector<Vec3f>& _normals)
+{
+	const char* data = _file.data();
+	const size_t size = _file.size();
+
+	if (size < 4 || memcmp(data, "ply", 3) != 0) {
+		std::cerr << _filename << ": not a PLY file" << std::endl;
+		return false;
+	}
+
+	// header, the vertex element is located by the sizes of the elements
+	// before it
+	const char* p = data;
+	std::string format;
+	size_t   offset = 0, n_vertices = 0;
+	int      stride = 0;
+	bool     in_vertex = false, found_vertex = false;
+	int      attr_offset[6], attr_size[6];
+	const char* names[6] = { "x", "y", "z", "nx", "ny", "nz" };
+	size_t   element_count = 0;
+	int      element_size = 0;
+	bool     element_list = false;
+
+	for (int a = 0; a < 6; a++) {
+		attr_offset[a] = -1;
+		attr_size[a] = 0;
+	}
+
+	for (;;)
+	{
+		const char* eol = (const char*)memchr(p, '\n', data + size - p);
+		if (!eol) {
+			std::cerr << _filename << ": incomplete PLY header" << std::endl;
+			return false;
+		}
+		std::string line(p, eol);
+		p = eol + 1;
+		if (!line.empty() && line[line.size()-1] == '\r') {
+			line.erase(line.size()-1);
+		}
+
+		char word[64], type[64], name[64];
+		unsigned long count;
+		if (line == "end_header") {
+			break;
+		}
+		else if (sscanf(line.c_str(), "format %63s", word) == 1) {
+			format = word;
+		}
+		else if (sscanf(line.c_str(), "element %63s %lu", word, &count) == 2) {
+			if (!found_vertex && element_list && element_count) {
+				std::cerr << _filename << ": cannot skip PLY list elements before the vertices" << std::endl;
+				return false;
+			}
+			if (!found_vertex) {
+				offset += element_count * element_size;
+			}
+			element_count = count;
+			element_size = 0;
+			element_list = false;
+			in_vertex = !found_vertex && std::string(word) == "vertex";
+			if (in_vertex) {
+				found_vertex = true;
+				n_vertices = count;
+			}
+		}
+		else if (sscanf(line.c_str(), "property list %63s %63s %63s", word, type, name) == 3) {
+			element_list = true;
+			if (in_vertex) {
+				std::cerr << _filename << ": PLY vertices with list properties are not supported" << std::endl;
+				return false;
+			}
+		}
+		else if (sscanf(line.c_str(), "property %63s %63s", type, name) == 2) {
+			int s = ply_type_size(type);
+			if (!s) {
+				std::cerr << _filename << ": unknown PLY type " << type << std::endl;
+				return false;
+			}
+			if (in_vertex) {
+				for (int a = 0; a < 6; a++) {
+					if (std::string(name) == names[a]) {
+						attr_offset[a] = stride;
+						attr_size[a] = s;
+					}
+				}
+				stride += s;
+			}
+			element_size += s;
+		}
+	}
+
+	if (format != "binary_little_endian") {
+		std::cerr << _filename << ": only binary little endian PLY files are supported" << std::endl;
+		return false;
+	}
+	if (!found_vertex || attr_offset[0] < 0 || attr_offset[1] < 0 || attr_offset[2] < 0) {
+		std::cerr << _filename << ": PLY file has no vertex positions" << std::endl;
+		return false;
+	}
+	for (int a = 0; a < 6; a++) {
+		if (attr_offset[a] >= 0 && attr_size[a] != 4 && attr_size[a] != 8) {
+			std::cerr << _filename << ": PLY vertex coordinates have to be float or double" << std::endl;
+			return false;
+		}
+	}
+
+	const char* vertices = p + offset;
+	if ((size_t)(data + size - vertices) < n_vertices * stride) {
+		std::cerr << _filename << ": file is truncated" << std::endl;
+		return false;
+	}
+
+	const bool has_normals =
+		attr_offset[3] >= 0 && attr_offset[4] >= 0 && attr_offset[5] >= 0;
+	_points.resize(n_vertices);
+	_normals.resize(has_normals ? n_vertices : 0);
+
+	// gather the coordinates from the vertex records
+	const int n = (int)n_vertices;
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; i++)
+	{
+		const char* v = vertices + (size_t)i * stride;
+		float x[6];
+		for (int a = 0; a < (has_normals ? 6 : 3); a++) {
+			if (attr_size[a] == 4) {
+				memcpy(&x[a], v + attr_offset[a], 4);
+			}
+			else {
+				double d;
+				memcpy(&d, v + attr_offset[a], 8);
+				x[a] = (float)d;
+			}
+		}
+		_points[i] = Vec3f(x[0], x[1], x[2]);
+		if (has_normals) {
+			_normals[i] = Vec3f(x[3], x[4], x[5]);
+		}
+	}
+
+	return true;
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool read_point_cloud(const char* _filename,
+					  std::vector<Vec3f>& _points,
+					  std::vector<Vec3f>& _normals)
+{
+	_points.clear();
+	_normals.clear();
+
+	MappedFile file(_filename);
+	if (!file.is_open()) {
+		std::cerr << "Cannot open file " << _filename << std::endl;
+		return false;
+	}
+	if (file.size() == 0) {
+		return true;
+	}
+
+	std::string ext = extension(_filename);
+	if (ext == "ptsb") {
+		return read_ptsb(file, _filename, _points, _normals);
+	}
+	if (ext == "ply") {
+		return read_ply(file, _filename, _points, _normals);
+	}
+	return read_pts(file, _filename, _points, _normals);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool write_point_cloud(const char* _filename,
+					   const std::vector<Vec3f>& _points,
+					   const std::vector<Vec3f>& _normals)
+{
+	const bool has_normals = !_normals.empty();
+	if (has_normals && _normals.size() != _points.size()) {
+		std::cerr << "Number of points and normals differ" << std::endl;
+		return false;
+	}
+
+	const bool binary = (extension(_filename) == "ptsb");
+	FILE* out = fopen(_filename, binary ? "wb" : "w");
+	if (!out) {
+		std::cerr << "Cannot write file " << _filename << std::endl;
+		return false;
+	}
+
+	bool ok = true;
+	if (binary)
+	{
+		uint32_t flags = has_normals ? 1 : 0;
+		uint64_t n = _points.size();
+		ok = fwrite("PTSB", 1, 4, out) == 4 &&
+			fwrite(&flags, 4, 1, out) == 1 &&
+			fwrite(&n, 8, 1, out) == 1;
+		if (ok && n) {
+			ok = fwrite(&_points[0], sizeof(Vec3f), n, out) == n;
+		}
+		if (ok && n && has_normals) {
+			ok = fwrite(&_normals[0], sizeof(Vec3f), n, out) == n;
+		}
+	}
+	else
+	{
+		for (unsigned int i = 0; ok && i < _points.size(); i++) {
+			const Vec3f& p = _points[i];
+			if (has_normals) {
+				const Vec3f& n = _normals[i];
+				ok = fprintf(out, "%.9g %.9g %.9g  %.9g %.9g %.9g\n",
+					p[0], p[1], p[2], n[0], n[1], n[2]) > 0;
+			}
+			else {
+				ok = fprintf(out, "%.9g %.9g %.9g\n", p[0], p[1], p[2]) > 0;
+			}
+		}
+	}
+
+	if (fclose(out) != 0) {
+		ok = false;
+	}
+	if (!ok) {
+		std::cerr << "Error writing " << _filename << std::endl;
+	}
+	return ok;
+}
+
+
+//=============================================================================
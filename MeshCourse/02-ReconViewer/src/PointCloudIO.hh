@@ -0,0 +1,48 @@
+//=============================================================================
+
+
+#ifndef POINTCLOUDIO_HH
+#define POINTCLOUDIO_HH
+
+
+//=============================================================================
+
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <vector>
+
+//=============================================================================
+
+
+// Reading and writing of point clouds with optional normals. The format is
+// chosen by the file extension:
+//
+//   .pts   ASCII, one point per line: "x y z" or "x y z nx ny nz". Unlike
+//          the former istream loop, a point must not be split over several
+//          lines; other lines are skipped and the first one is reported
+//   .ptsb  binary: the 4 bytes "PTSB", a uint32 with bit 0 set if there are
+//          normals, a uint64 point count n, then n points and (optionally)
+//          n normals as 3 floats each
+//   .ply   binary little endian PLY, the vertex element's x,y,z and
+//          nx,ny,nz properties are read, all other elements are ignored
+//
+// Files are memory mapped. ASCII files are split into chunks of whole lines
+// that are parsed in parallel. Binary data is copied from the mapping with
+// memcpy, as whole arrays for .ptsb and per vertex for .ply. Binary formats
+// are read and written in the (little endian) byte order of the host.
+//
+// _normals is left empty if the file does not contain normals. On errors a
+// message is printed and false is returned.
+bool read_point_cloud(const char* _filename,
+	std::vector<OpenMesh::Vec3f>& _points,
+	std::vector<OpenMesh::Vec3f>& _normals);
+
+// write a .pts or .ptsb file, _normals may be empty
+bool write_point_cloud(const char* _filename,
+	const std::vector<OpenMesh::Vec3f>& _points,
+	const std::vector<OpenMesh::Vec3f>& _normals);
+
+
+//=============================================================================
+#endif // POINTCLOUDIO_HH defined
+//=============================================================================
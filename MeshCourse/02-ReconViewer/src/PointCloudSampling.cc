@@ -0,0 +1,393 @@
+//=============================================================================
+
+
+#include "PointCloudSampling.hh"
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+typedef OpenMesh::Vec3f Vec3f;
+
+// marks free slots of the cell hash table
+const uint64_t EMPTY_KEY = ~(uint64_t)0;
+
+
+// Sparse grid of cubic cells. Every cell is identified by its integer
+// coordinates packed into 21 bits each; an open addressing hash table maps
+// these keys to dense cell indices, and the points are sorted into the
+// cells by a counting sort that keeps their given order within every cell.
+class CellGrid
+{
+public:
+
+	enum { BITS = 21, BORDER = 2 };
+
+	// _order is the order in which the points are stored in the cells
+	CellGrid(const std::vector<Vec3f>& _points, const std::vector<int>& _order,
+		float _cell_size);
+
+	int n_cells() const { return (int)cell_keys_.size(); }
+
+	// [begin,end) of the points of cell _c
+	const int* begin(int _c) const { return &points_[0] + first_[_c]; }
+	const int* end(int _c) const   { return &points_[0] + first_[_c+1]; }
+
+	uint64_t key(int _c) const { return cell_keys_[_c]; }
+
+	// index of the cell with key _key, -1 for empty cells
+	int find(uint64_t _key) const
+	{
+		for (size_t h = hash(_key); ; h = (h+1) & mask_) {
+			if (table_keys_[h] == _key) return table_cells_[h];
+			if (table_keys_[h] == EMPTY_KEY) return -1;
+		}
+	}
+
+	static uint64_t pack(int _x, int _y, int _z)
+	{
+		return (uint64_t)_x | ((uint64_t)_y << BITS) | ((uint64_t)_z << 2*BITS);
+	}
+	static int unpack(uint64_t _key, int _axis)
+	{
+		return (int)((_key >> _axis*BITS) & ((1<<BITS) - 1));
+	}
+
+private:
+
+	size_t hash(uint64_t _key) const
+	{
+		return (size_t)((_key * 0x9E3779B97F4A7C15ULL) >> 32) & mask_;
+	}
+
+	std::vector<uint64_t>	table_keys_;
+	std::vector<int>		table_cells_;
+	size_t					mask_;
+
+	std::vector<uint64_t>	cell_keys_;
+	std::vector<int>		first_, points_;
+};
+
+
+CellGrid::CellGrid(const std::vector<Vec3f>& _points,
+				   const std::vector<int>& _order, float _cell_size)
+{
+	const int n = (int)_order.size();
+
+	Vec3f bb_min(_points[_order[0]]), bb_max(bb_min);
+	for (int i = 1; i < n; i++) {
+		bb_min.minimize(_points[_order[i]]);
+		bb_max.maximize(_points[_order[i]]);
+	}
+
+	// coarsen the cells if the coordinates do not fit into BITS bits, the
+	// cells are offset by BORDER such that all neighbors have valid keys
+	float extent = (bb_max - bb_min).max();
+	float min_size = extent / (float)((1<<BITS) - 2*BORDER - 2);
+	float cell_size = std::max(_cell_size, min_size);
+	if (cell_size <= 0) {
+		cell_size = 1;
+	}
+	const float inv = 1.0f / cell_size;
+
+	// cell key of every point
+	std::vector<uint64_t> keys(n);
+	int i;
+
+#pragma omp parallel for schedule(static)
+	for (i = 0; i < n; i++)
+	{
+		Vec3f d = (_points[_order[i]] - bb_min) * inv;
+		int c[3];
+		for (int a = 0; a < 3; a++) {
+			c[a] = std::min((int)d[a], (1<<BITS) - 2*BORDER - 2) + BORDER;
+		}
+		keys[i] = pack(c[0], c[1], c[2]);
+	}
+
+	// hash table with a load factor <= 1/2
+	size_t capacity = 16;
+	while (capacity < 2 * (size_t)n) {
+		capacity *= 2;
+	}
+	mask_ = capacity - 1;
+	table_keys_.assign(capacity, EMPTY_KEY);
+	table_cells_.resize(capacity);
+
+	std::vector<int> cell_of(n);
+	for (i = 0; i < n; i++)
+	{
+		size_t h = hash(keys[i]);
+		while (table_keys_[h] != EMPTY_KEY && table_keys_[h] != keys[i]) {
+			h = (h+1) & mask_;
+		}
+		if (table_keys_[h] == EMPTY_KEY) {
+			table_keys_[h] = keys[i];
+			table_cells_[h] = (int)cell_keys_.size();
+			cell_keys_.push_back(keys[i]);
+		}
+		cell_of[i] = table_cells_[h];
+	}
+
+	// counting sort of the points into the cells
+	first_.assign(cell_keys_.size() + 1, 0);
+	for (i = 0; i < n; i++) {
+		first_[cell_of[i]+1]++;
+	}
+	for (size_t c = 0; c < cell_keys_.size(); c++) {
+		first_[c+1] += first_[c];
+	}
+	std::vector<int> fill(first_.begin(), first_.end() - 1);
+	points_.resize(n);
+	for (i = 0; i < n; i++) {
+		points_[fill[cell_of[i]]++] = _order[i];
+	}
+}
+
+
+// copy the selected points (and normals) to the output vectors
+void gather(const std::vector<Vec3f>& _points, const std::vector<Vec3f>& _normals,
+			const std::vector<int>& _selected,
+			std::vector<Vec3f>& _out_points, std::vector<Vec3f>& _out_normals)
+{
+	const int n = (int)_selected.size();
+	_out_points.resize(n);
+	_out_normals.resize(_normals.empty() ? 0 : n);
+	int i;
+
+#pragma omp parallel for schedule(static)
+	for (i = 0; i < n; i++)
+	{
+		_out_points[i] = _points[_selected[i]];
+		if (!_normals.empty()) {
+			_out_normals[i] = _normals[_selected[i]];
+		}
+	}
+}
+
+
+// the sample indices of a Poisson disk subset with radius _radius
+void poisson_disk(const std::vector<Vec3f>& _points, const std::vector<int>& _order,
+				  float _radius, std::vector<int>& _selected)
+{
+	// cells with diagonal _radius: at most one sample per cell, and all
+	// samples closer than _radius are at most 2 cells away
+	CellGrid grid(_points, _order, _radius / std::sqrt(3.0f));
+	const int n_cells = grid.n_cells();
+	const float sqr_radius = _radius * _radius;
+
+	// cells whose coordinates agree modulo 3 are >= 3 cells apart, so they
+	// neither conflict nor read each other's samples
+	std::vector<int> phase_cells[27];
+	for (int c = 0; c < n_cells; c++)
+	{
+		uint64_t key = grid.key(c);
+		int phase = CellGrid::unpack(key, 0) % 3 +
+			3 * (CellGrid::unpack(key, 1) % 3) + 9 * (CellGrid::unpack(key, 2) % 3);
+		phase_cells[phase].push_back(c);
+	}
+
+	std::vector<int> sample(n_cells, -1);
+
+	for (int phase = 0; phase < 27; phase++)
+	{
+		const std::vector<int>& cells = phase_cells[phase];
+		const int n = (int)cells.size();
+		int i;
+
+#pragma omp parallel for schedule(dynamic, 64)
+		for (i = 0; i < n; i++)
+		{
+			const int c = cells[i];
+			const uint64_t key = grid.key(c);
+			const int x = CellGrid::unpack(key, 0);
+			const int y = CellGrid::unpack(key, 1);
+			const int z = CellGrid::unpack(key, 2);
+
+			// samples in the 5x5x5 neighborhood
+			Vec3f neighbors[125];
+			int n_neighbors = 0;
+			for (int dz = -2; dz <= 2; dz++) {
+				for (int dy = -2; dy <= 2; dy++) {
+					for (int dx = -2; dx <= 2; dx++) {
+						int nc = grid.find(CellGrid::pack(x+dx, y+dy, z+dz));
+						if (nc >= 0 && sample[nc] >= 0) {
+							neighbors[n_neighbors++] = _points[sample[nc]];
+						}
+					}
+				}
+			}
+
+			// the first point of the cell that keeps the distance
+			for (const int* p = grid.begin(c); p != grid.end(c); p++)
+			{
+				int j;
+				for (j = 0; j < n_neighbors; j++) {
+					if ((_points[*p] - neighbors[j]).sqrnorm() < sqr_radius) {
+						break;
+					}
+				}
+				if (j == n_neighbors) {
+					sample[c] = *p;
+					break;
+				}
+			}
+		}
+	}
+
+	_selected.clear();
+	for (int c = 0; c < n_cells; c++) {
+		if (sample[c] >= 0) {
+			_selected.push_back(sample[c]);
+		}
+	}
+}
+
+
+// fixed pseudo-random permutation of [0,_n), independent of the platform
+void shuffled_order(int _n, std::vector<int>& _order)
+{
+	_order.resize(_n);
+	for (int i = 0; i < _n; i++) {
+		_order[i] = i;
+	}
+	uint64_t state = 0x2545F4914F6CDD1DULL;
+	for (int i = _n-1; i > 0; i--)
+	{
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		int j = (int)((state >> 33) % (uint64_t)(i+1));
+		std::swap(_order[i], _order[j]);
+	}
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+
+
+void voxel_downsample(const std::vector<Vec3f>& _points,
+					  const std::vector<Vec3f>& _normals, float _voxel_size,
+					  std::vector<Vec3f>& _out_points, std::vector<Vec3f>& _out_normals)
+{
+	if (_points.empty() || _voxel_size <= 0) {
+		_out_points = _points;
+		_out_normals = _normals;
+		return;
+	}
+
+	std::vector<int> order(_points.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = (int)i;
+	}
+	CellGrid grid(_points, order, _voxel_size);
+
+	const int n_cells = grid.n_cells();
+	const bool has_normals = !_normals.empty();
+	_out_points.resize(n_cells);
+	_out_normals.resize(has_normals ? n_cells : 0);
+	int c;
+
+#pragma omp parallel for schedule(dynamic, 256)
+	for (c = 0; c < n_cells; c++)
+	{
+		OpenMesh::Vec3d p(0, 0, 0), nrm(0, 0, 0);
+		for (const int* i = grid.begin(c); i != grid.end(c); i++)
+		{
+			p += OpenMesh::Vec3d(_points[*i]);
+			if (has_normals) {
+				nrm += OpenMesh::Vec3d(_normals[*i]);
+			}
+		}
+		_out_points[c] = Vec3f(p / (double)(grid.end(c) - grid.begin(c)));
+
+		if (has_normals)
+		{
+			// opposite normals cancel out, keep the first one then
+			double l = nrm.norm();
+			_out_normals[c] = (l > 0) ? Vec3f(nrm / l) : _normals[*grid.begin(c)];
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void poisson_disk_downsample(const std::vector<Vec3f>& _points,
+							 const std::vector<Vec3f>& _normals, float _radius,
+							 std::vector<Vec3f>& _out_points, std::vector<Vec3f>& _out_normals)
+{
+	if (_points.empty() || _radius <= 0) {
+		_out_points = _points;
+		_out_normals = _normals;
+		return;
+	}
+
+	std::vector<int> order, selected;
+	shuffled_order((int)_points.size(), order);
+	poisson_disk(_points, order, _radius, selected);
+	gather(_points, _normals, selected, _out_points, _out_normals);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+float poisson_disk_downsample_count(const std::vector<Vec3f>& _points,
+									const std::vector<Vec3f>& _normals, int _target_count,
+									std::vector<Vec3f>& _out_points, std::vector<Vec3f>& _out_normals)
+{
+	const int n = (int)_points.size();
+	if (n == 0 || _target_count <= 0 || _target_count >= n) {
+		_out_points = _points;
+		_out_normals = _normals;
+		return 0;
+	}
+
+	Vec3f bb_min(_points[0]), bb_max(bb_min);
+	for (int i = 1; i < n; i++) {
+		bb_min.minimize(_points[i]);
+		bb_max.maximize(_points[i]);
+	}
+
+	std::vector<int> order, selected, best;
+	shuffled_order(n, order);
+
+	// the count decreases with the radius: bisect on a log scale, stop at
+	// 1% deviation from the target
+	double lo = (bb_max - bb_min).norm() * 1e-6, hi = (bb_max - bb_min).norm();
+	float best_radius = 0;
+	int best_error = n;
+
+	for (int iter = 0; iter < 40 && best_error > _target_count / 100; iter++)
+	{
+		float radius = (float)std::sqrt(lo * hi);
+		poisson_disk(_points, order, radius, selected);
+
+		const int count = (int)selected.size();
+		if (std::abs(count - _target_count) < best_error) {
+			best_error = std::abs(count - _target_count);
+			best_radius = radius;
+			best.swap(selected);
+		}
+
+		if (count > _target_count) {
+			lo = radius;
+		}
+		else {
+			hi = radius;
+		}
+	}
+
+	gather(_points, _normals, best, _out_points, _out_normals);
+	return best_radius;
+}
+
+
+//=============================================================================
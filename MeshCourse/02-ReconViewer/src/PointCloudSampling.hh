@@ -0,0 +1,53 @@
+//=============================================================================
+
+
+#ifndef POINTCLOUDSAMPLING_HH
+#define POINTCLOUDSAMPLING_HH
+
+
+//=============================================================================
+
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <vector>
+
+//=============================================================================
+
+
+// Downsampling of oversampled point clouds before fitting. Both methods
+// hash the points into a sparse grid of cubic cells (open addressing over
+// the packed integer cell coordinates), so they run in time linear in the
+// number of points; the per-point and per-cell work is parallelized by
+// OpenMP and the result does not depend on the number of threads.
+//
+// _normals may be empty, then _out_normals is empty as well. The input and
+// output vectors must not be the same.
+
+// replace the points of every cube of edge length _voxel_size by their
+// centroid, and their normals by the normalized average normal
+void voxel_downsample(const std::vector<OpenMesh::Vec3f>& _points,
+	const std::vector<OpenMesh::Vec3f>& _normals, float _voxel_size,
+	std::vector<OpenMesh::Vec3f>& _out_points,
+	std::vector<OpenMesh::Vec3f>& _out_normals);
+
+// maximal subset of the points with pairwise distances >= _radius. The grid
+// cells have a diagonal of _radius, so every cell holds at most one sample;
+// cells are processed in 27 independent phases (cell coordinates modulo 3)
+// whose cells are sampled in parallel, trying their points in a fixed
+// pseudo-random order.
+void poisson_disk_downsample(const std::vector<OpenMesh::Vec3f>& _points,
+	const std::vector<OpenMesh::Vec3f>& _normals, float _radius,
+	std::vector<OpenMesh::Vec3f>& _out_points,
+	std::vector<OpenMesh::Vec3f>& _out_normals);
+
+// Poisson disk subset with about _target_count points, the radius is found
+// by bisection and returned
+float poisson_disk_downsample_count(const std::vector<OpenMesh::Vec3f>& _points,
+	const std::vector<OpenMesh::Vec3f>& _normals, int _target_count,
+	std::vector<OpenMesh::Vec3f>& _out_points,
+	std::vector<OpenMesh::Vec3f>& _out_normals);
+
+
+//=============================================================================
+#endif // POINTCLOUDSAMPLING_HH defined
+//=============================================================================
@@ -1,44 +1,88 @@
 #pragma once
 
-class RBF
-{
-public:
-	virtual float operator()(float dist) const = 0;
-};
+#include <IsoEx/Math/SSE.hh>
+#include <algorithm>
+#include <cmath>
 
+// Kernels for ImplicitRBFT. They are plain classes instead of implementations
+// of a virtual interface: ImplicitRBFT is a template on the kernel type, so
+// the kernel calls in the matrix fill and evaluation loops are inlined. Every
+// kernel provides
+//
+//   T operator()(T dist) const             the kernel at distance dist, for
+//                                          T = float and double
+//   void evaluate(dist, n, values) const   the same for n distances at once,
+//                                          double arrays, vectorized with
+//                                          SSE2 and bit-identical to
+//                                          operator()
+//   float support() const                  radius outside of which the kernel
+//                                          vanishes, 0 for global support
+//   enum { TREECODE }                      1 if sums of the kernel can be
+//                                          evaluated by TriharmonicTreecode
 
-class TriharmonicRbf : public RBF
+
+class TriharmonicRbf
 {
 public:
-	float operator()(float dist) const {
+	enum { TREECODE = 1 };
+
+	template <typename Scalar>
+	Scalar operator()(Scalar dist) const {
 		return dist * dist * dist;
 	}
+	void evaluate(const double* _dist, int _n, double* _values) const {
+		int i = 0;
+#ifdef ISOEX_SSE2
+		for (; i+2 <= _n; i += 2) {
+			__m128d r = _mm_loadu_pd(_dist+i);
+			_mm_storeu_pd(_values+i, _mm_mul_pd(_mm_mul_pd(r, r), r));
+		}
+#endif
+		for (; i < _n; i++)
+			_values[i] = (*this)(_dist[i]);
+	}
+	float support() const {
+		return 0;
+	}
 };
 
-class CubicBSplineRbf : public RBF
+class CubicBSplineRbf
 {
 public:
+	enum { TREECODE = 0 };
+
 	CubicBSplineRbf(float _betha = 1.0) : betha(_betha) {}
-	float operator()(float dist) const {
-		float s = dist/betha;
-		float s2 = s*s;
-		float s3 = s2*s;
-		if ( s < -2 || s > 2) {
-			return 0;
-		}
-		if (s > -2 && s < -1) {
-			return (2 + s)*(2 + s)*(2 + s)/6;
-		}
-		if (s > -1 && s < 0) {
-			return ( 4 - 6*s2 - 3*s3 )/6;
-		}
-		if (s > 0 && s < 1) {
-			return ( 4 - 6*s2 + 3*s3 )/6;
-		}
-		if (s > 1 && s < 2) {
-			return (2 - s)*(2 - s)*(2 - s)/6;
+	// branch-free form of the piecewise cubic: ((2-|s|)_+^3 - 4 (1-|s|)_+^3) / 6
+	template <typename Scalar>
+	Scalar operator()(Scalar dist) const {
+		Scalar s = std::fabs(dist/betha);
+		Scalar a = std::max(Scalar(2) - s, Scalar(0));
+		Scalar b = std::max(Scalar(1) - s, Scalar(0));
+		return (a*a*a - Scalar(4)*b*b*b) * (Scalar(1)/Scalar(6));
+	}
+	void evaluate(const double* _dist, int _n, double* _values) const {
+		int i = 0;
+#ifdef ISOEX_SSE2
+		// the operations of operator() in the same order
+		const __m128d width = _mm_set1_pd(betha);
+		const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+		const __m128d two = _mm_set1_pd(2.0), four = _mm_set1_pd(4.0);
+		const __m128d sixth = _mm_set1_pd(1.0 / 6.0);
+		const __m128d sign = _mm_set1_pd(-0.0);
+		for (; i+2 <= _n; i += 2) {
+			__m128d s = _mm_andnot_pd(sign, _mm_div_pd(_mm_loadu_pd(_dist+i), width));
+			__m128d a = _mm_max_pd(_mm_sub_pd(two, s), zero);
+			__m128d b = _mm_max_pd(_mm_sub_pd(one, s), zero);
+			a = _mm_mul_pd(_mm_mul_pd(a, a), a);
+			b = _mm_mul_pd(_mm_mul_pd(_mm_mul_pd(four, b), b), b);
+			_mm_storeu_pd(_values+i, _mm_mul_pd(_mm_sub_pd(a, b), sixth));
 		}
-		return 0;
+#endif
+		for (; i < _n; i++)
+			_values[i] = (*this)(_dist[i]);
+	}
+	float support() const {
+		return 2*betha;
 	}
 	float betha;
 };
\ No newline at end of file
@@ -45,12 +45,19 @@
 #include <OpenMesh/Tools/Utils/Timer.hh>
 
 #include <IsoEx/Grids/ScalarGridT.hh>
+#include <IsoEx/Grids/NarrowBandSampler.hh>
 #include <IsoEx/Extractors/MarchingCubesT.hh>
+#include <IsoEx/Extractors/ParallelMarchingCubesT.hh>
 
 #include "ReconViewer.hh"
 #include "ImplicitRBF.hh"
 #include "ImplicitMLS.hh"
+#include "ImplicitPU.hh"
+#include "PointCloudIO.hh"
+#include "NormalEstimation.hh"
+#include "GridCache.hh"
 #include <vector>
+#include <algorithm>
 #include <float.h>
 
 #include <windows.h>
@@ -68,6 +75,11 @@ ReconViewer::
 	epsilon=0.01;
 	betha = 1;
 	rbf_to_use = TRIHARMONIC;
+	treecode_tolerance = 0;
+	greedy_tolerance = 0;
+	rbf_solver = RBF_DENSE;
+	narrow_band = false;
+	grid_cache = false;
 	add_draw_mode("Point Cloud");
 
 }
@@ -162,7 +174,48 @@ void
 
 //=============================================================================
 
-void ReconViewer::MeshFromFunction(Implicit* ImpFunc)
+uint64_t ReconViewer::GridCacheKey(char method)
+{
+	// narrow band grids may miss surface components of the dense grid, see
+	// IsoEx::NarrowBandSamplerT, they are cached separately
+	GridKey key;
+	key << Points << Normals << (int)method << MC_RESOLUTION << (int)narrow_band;
+	if (method == 'r')
+	{
+		key << (int)rbf_to_use << epsilon << betha << treecode_tolerance
+			<< greedy_tolerance << (int)rbf_solver;
+	}
+	if (method == 'p')
+	{
+		key << epsilon;
+	}
+	return key.value();
+}
+
+
+bool ReconViewer::MeshFromCache(uint64_t cache_key)
+{
+	IsoEx::ScalarGridT<Scalar>  grid;
+	if (!grid_cache || !GridCache(".").load(cache_key, grid))
+	{
+		return false;
+	}
+	std::cout << "Cached grid " << GridCache(".").filename(cache_key) << "\n";
+
+	// culled blocks of narrow band grids are constant, the full Marching
+	// Cubes gives the same mesh as on the active cubes
+	std::cout << "Marching Cubes\n" << std::flush;
+	parallel_marching_cubes(grid, mesh_);
+
+	mesh_.update_normals();
+	update_face_indices();
+	std::cerr << mesh_.n_vertices() << " vertices, "
+		<< mesh_.n_faces()    << " faces\n";
+	return true;
+}
+
+
+void ReconViewer::MeshFromFunction(Implicit* ImpFunc, uint64_t cache_key)
 {
 	std::cout << "Bounding Box\n" << std::flush;
 	Point bb_min( Points[0]), bb_max( Points[0]);
@@ -181,12 +234,13 @@ void ReconViewer::MeshFromFunction(Implicit* ImpFunc)
 	// setup Marching Cubes grid by sampling RBF
 	std::cout << "Setup grid\n" << std::flush;
 
+	// resolution proportional to the extent of each axis, as in reconstruct
 	float MeanSize = VecDiag.mean();
 	int res[3];
 	int idir;
 	for (idir=0; idir<3; idir++)
 	{
-		res[idir] = (int)(MC_RESOLUTION * VecDiag[0]/MeanSize + 0.5); 
+		res[idir] = std::max(2, (int)(MC_RESOLUTION * VecDiag[idir]/MeanSize + 0.5));
 	}
 	IsoEx::ScalarGridT<Scalar>  grid(bb_min,
 		Point(bb_max[0]-bb_min[0], 0, 0),
@@ -194,15 +248,31 @@ void ReconViewer::MeshFromFunction(Implicit* ImpFunc)
 		Point(0, 0, bb_max[2]-bb_min[2]),
 		res[0], res[1], res[2]);
 
-	for (unsigned int x=0; x<res[0]; ++x)
-		for (unsigned int y=0; y<res[1]; ++y)
-			for (unsigned int z=0; z<res[2]; ++z)
-				grid.value(x,y,z) = (*ImpFunc)( grid.point(x,y,z) );
+	if (narrow_band)
+	{
+		// sample close to the surface only
+		std::vector<IsoEx::Grid::CubeIdx> cubes;
+		unsigned int n = IsoEx::sample_narrow_band(grid, *ImpFunc, 0, cubes);
+		std::cout << n << " of " << grid.n_points() << " points sampled, "
+			<< cubes.size() << " active cubes\n";
+
+		std::cout << "Marching Cubes\n" << std::flush;
+		marching_cubes(grid, cubes, mesh_);
+	}
+	else
+	{
+		// sample the implicit function in parallel
+		grid.sample_function(*ImpFunc);
 
+		// isosurface extraction by Marching Cubes
+		std::cout << "Marching Cubes\n" << std::flush;
+		parallel_marching_cubes(grid, mesh_); 
+	}
 
-	// isosurface extraction by Marching Cubes
-	std::cout << "Marching Cubes\n" << std::flush;
-	marching_cubes(grid, mesh_); 
+	if (grid_cache && !GridCache(".").store(cache_key, grid))
+	{
+		std::cerr << "Cannot write " << GridCache(".").filename(cache_key) << "\n";
+	}
 
 	mesh_.update_normals();
 
@@ -233,27 +303,21 @@ void
 			ofn.nMaxFile=MAX_PATH;
 			if(GetOpenFileName(&ofn));
 			{
-				Points.clear();
-				Normals.clear();
-				//std::ifstream ifs(dlg.GetPathName());
-				std::ifstream ifs(szFileName);
-				if (!ifs) 
+				// .pts, .ptsb or binary .ply, see PointCloudIO.hh
+				if (!read_point_cloud(szFileName, Points, Normals) || Points.empty())
 				{
-					std::cerr << "Cannot open file\n";
-					exit(1);
+					Points.clear();
+					Normals.clear();
+					break;
 				}
-
-				Point                p, n;
-
-				while (ifs && !ifs.eof())
+				if (Normals.empty())
 				{
-					ifs >> p[0] >> p[1] >> p[2];
-					ifs >> n[0] >> n[1] >> n[2];
-					Points.push_back(p);
-					Normals.push_back(n);
+					// all fits need oriented normals, estimate them from
+					// the 12 nearest neighbors
+					std::cout << "Estimating normals\n";
+					estimate_normals(Points, 12, Normals);
 				}
 				std::cout << Points.size() << " sample points\n";
-				ifs.close();
 
 				//establishing bounding box for drawing
 				Mesh::Point            bbMin, bbMax;
@@ -271,27 +335,46 @@ void
 
 		//RBF interpolation
 	case 'r':{
+		uint64_t cache_key = GridCacheKey('r');
+		if (MeshFromCache(cache_key)) break;
 		std::cout << "Fit RBF\n" << std::flush;
-		RBF* _rbf;
+		// the kernel is a template argument, select it once here
 		switch (rbf_to_use) {
-		case TRIHARMONIC:
-			_rbf = new TriharmonicRbf();
+		case TRIHARMONIC: {
+			ImplicitRBFT<TriharmonicRbf>  implicitRBF_( Points, Normals, epsilon,
+				TriharmonicRbf(), greedy_tolerance, rbf_solver);
+			implicitRBF_.use_treecode(treecode_tolerance);
+			if (!implicitRBF_.converged()) break;	// see the message of the fit
+			MeshFromFunction((Implicit*)&implicitRBF_, cache_key);
 			break;
-		case BSPLINE:
-			_rbf = new CubicBSplineRbf(betha);
+		}
+		case BSPLINE: {
+			ImplicitRBFT<CubicBSplineRbf>  implicitRBF_( Points, Normals, epsilon,
+				CubicBSplineRbf(betha), greedy_tolerance, rbf_solver);
+			if (!implicitRBF_.converged()) break;	// see the message of the fit
+			MeshFromFunction((Implicit*)&implicitRBF_, cache_key);
 			break;
 		}
-
-		ImplicitRBF  implicitRBF_( Points, Normals, epsilon, *_rbf);
-		MeshFromFunction((Implicit*)&implicitRBF_);
-		delete _rbf;
+		}
 		break;
 			 }
 
 	case 'm':{
+		uint64_t cache_key = GridCacheKey('m');
+		if (MeshFromCache(cache_key)) break;
 		std::cout << "Fit MLS\n" << std::flush;
 		ImplicitMLS  implicitMLS_( Points, Normals);
-		MeshFromFunction((Implicit*)&implicitMLS_);
+		MeshFromFunction((Implicit*)&implicitMLS_, cache_key);
+		break;
+			 }
+
+		//partition of unity of local RBFs, for large point clouds
+	case 'p':{
+		uint64_t cache_key = GridCacheKey('p');
+		if (MeshFromCache(cache_key)) break;
+		std::cout << "Fit partition of unity\n" << std::flush;
+		ImplicitPU  implicitPU_( Points, Normals, epsilon);
+		MeshFromFunction((Implicit*)&implicitPU_, cache_key);
 		break;
 			 }
 
@@ -316,6 +399,39 @@ void
 		betha += 0.1;
 		std::cout <<"Betha ="<<betha<<"\n"<<std::flush;
 		break;
+	case 'c':
+		// treecode pays off for large point sets only (~10k centers)
+		treecode_tolerance = (treecode_tolerance > 0) ? 0 : 1e-5;
+		std::cout <<"Treecode tolerance ="<<treecode_tolerance<<"\n"<<std::flush;
+		break;
+	case 'g':
+		// greedy center selection pays off for densely sampled surfaces
+		greedy_tolerance = (greedy_tolerance > 0) ? 0 : 1e-3;
+		std::cout <<"Greedy tolerance ="<<greedy_tolerance<<"\n"<<std::flush;
+		break;
+	case 's':
+		// the single precision and matrix-free solvers need less memory,
+		// see ImplicitRBFT::fit_dense() and fit_matrix_free()
+		rbf_solver = (RbfSolver)(((int)rbf_solver + 1) % 3);
+		if (rbf_solver == RBF_DENSE) {
+			std::cout << "Dense RBF solver" << std::endl << std::flush;
+		}
+		if (rbf_solver == RBF_DENSE_SINGLE) {
+			std::cout << "Single precision RBF solver" << std::endl << std::flush;
+		}
+		if (rbf_solver == RBF_MATRIX_FREE) {
+			std::cout << "Matrix-free RBF solver" << std::endl << std::flush;
+		}
+		break;
+	case 'k':
+		// identical fits load their sampled grid instead of resampling
+		grid_cache = !grid_cache;
+		std::cout << "Grid cache " << (grid_cache ? "on" : "off") << "\n" << std::flush;
+		break;
+	case 'n':
+		narrow_band = !narrow_band;
+		std::cout << "Narrow band sampling " << (narrow_band ? "on" : "off") << "\n" << std::flush;
+		break;
 	case 't':
 		rbf_to_use = (ReconRBF)(((int)rbf_to_use + 1) % 2);
 		if (rbf_to_use == TRIHARMONIC) {
@@ -49,7 +49,8 @@
 #include "Implicit.h"
 #include <iostream>
 #include <fstream>
-#include "RBF.h"
+#include "ImplicitRBF.hh"
+#include "GridCache.hh"
 
 
 
@@ -82,8 +83,14 @@ public:
 	//overloading GLUT keyboard
 	virtual void keyboard(int key, int x, int y);
 
-	//construcing mesh from grid
-	void MeshFromFunction(Implicit* ImpFunc);
+	//construcing mesh from grid, stored in the grid cache under cache_key
+	void MeshFromFunction(Implicit* ImpFunc, uint64_t cache_key);
+
+	//cache key of the grid sampled by the given method with the current parameters
+	uint64_t GridCacheKey(char method);
+
+	//constructing mesh from a cached grid, false if there is none
+	bool MeshFromCache(uint64_t cache_key);
 
 
 
@@ -94,6 +101,11 @@ protected:
 	float epsilon;
 	float betha;
 	ReconRBF rbf_to_use;
+	double treecode_tolerance; // 0 for direct RBF evaluation
+	double greedy_tolerance; // 0 uses all constraints as RBF centers
+	RbfSolver rbf_solver; // dense, dense in float or matrix-free
+	bool narrow_band; // sample the grid close to the surface only
+	bool grid_cache; // reuse sampled grids stored in the working directory
 
 private:
 
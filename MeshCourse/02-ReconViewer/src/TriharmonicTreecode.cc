@@ -0,0 +1,334 @@
+//=============================================================================
+
+
+//=============================================================================
+
+
+#include "TriharmonicTreecode.hh"
+#include <algorithm>
+#include <cmath>
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+// orders center indices along one coordinate axis
+struct AxisLess
+{
+	AxisLess(const std::vector<OpenMesh::Vec3f>& _points, int _axis)
+		: points_(_points), axis_(_axis) {}
+
+	bool operator()(int _i, int _j) const
+	{
+		return points_[_i][axis_] < points_[_j][axis_];
+	}
+
+	const std::vector<OpenMesh::Vec3f>&	points_;
+	int									axis_;
+};
+
+
+// exponents (a,b,c) of the monomials x^a y^b z^c of degree <= 4, sorted by
+// degree, together with their multinomial coefficients (a+b+c)! / (a! b! c!)
+struct Monomials
+{
+	Monomials()
+	{
+		static const int factorial[5] = { 1, 1, 2, 6, 24 };
+		int m = 0;
+		for (int degree = 0; degree <= 4; degree++) {
+			first[degree] = m;
+			for (int a = degree; a >= 0; a--) {
+				for (int b = degree-a; b >= 0; b--, m++) {
+					int c = degree-a-b;
+					exponent[m][0] = a;
+					exponent[m][1] = b;
+					exponent[m][2] = c;
+					coefficient[m] = factorial[degree] / 
+						(factorial[a] * factorial[b] * factorial[c]);
+					index[a][b][c] = m;
+				}
+			}
+		}
+		first[5] = m;
+	}
+
+	int		first[6];		// first monomial of each degree
+	int		exponent[35][3];
+	double	coefficient[35];
+	int		index[5][5][5];
+};
+
+const Monomials monomials;
+
+
+// sum over all monomials of degree _degree of coefficient * u^a * M_a, where
+// _shift is added to the exponents of the moments M
+double contract(const double* _moments, const double _u[3][5], int _degree,
+				int _sx = 0, int _sy = 0, int _sz = 0)
+{
+	double sum = 0;
+	for (int m = monomials.first[_degree]; m < monomials.first[_degree+1]; m++)
+	{
+		const int* e = monomials.exponent[m];
+		int moment = monomials.index[e[0]+_sx][e[1]+_sy][e[2]+_sz];
+		sum += monomials.coefficient[m] * _u[0][e[0]] * _u[1][e[1]] * _u[2][e[2]]
+			* _moments[moment];
+	}
+	return sum;
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void TriharmonicTreecode::build(const std::vector<Vec3f>& _centers)
+{
+	int n = (int)_centers.size();
+
+	centers_ = _centers;
+	index_.resize(n);
+	for (int i = 0; i < n; i++) {
+		index_[i] = i;
+	}
+
+	nodes_.clear();
+	nodes_.reserve(2 * (n / LEAF_SIZE + 1));
+	if (n == 0) {
+		return;
+	}
+	nodes_.push_back(Node());
+	build(0, 0, n);
+
+	// store the centers in tree order
+	for (int i = 0; i < n; i++) {
+		centers_[i] = _centers[index_[i]];
+	}
+	weights_.assign(n, 0.0);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void TriharmonicTreecode::build(int _idx, int _begin, int _end)
+{
+	int i;
+
+	// bounding sphere around the centroid
+	Vec3d center(0,0,0);
+	Vec3f bb_min(centers_[index_[_begin]]), bb_max(bb_min);
+	for (i = _begin; i < _end; i++) {
+		const Vec3f& c = centers_[index_[i]];
+		center += Vec3d(c[0], c[1], c[2]);
+		bb_min.minimize(c);
+		bb_max.maximize(c);
+	}
+	center /= (double)(_end - _begin);
+
+	double radius = 0;
+	for (i = _begin; i < _end; i++) {
+		const Vec3f& c = centers_[index_[i]];
+		radius = std::max(radius, (Vec3d(c[0], c[1], c[2]) - center).sqrnorm());
+	}
+
+	nodes_[_idx].begin  = _begin;
+	nodes_[_idx].end    = _end;
+	nodes_[_idx].child  = -1;
+	nodes_[_idx].center = center;
+	nodes_[_idx].radius = sqrt(radius);
+
+	if (_end - _begin <= LEAF_SIZE) {
+		return;
+	}
+
+	// split at the median of the axis of largest extent
+	Vec3f extent = bb_max - bb_min;
+	int axis = 0;
+	if (extent[1] > extent[axis]) axis = 1;
+	if (extent[2] > extent[axis]) axis = 2;
+
+	int mid = (_begin + _end) / 2;
+	std::nth_element(index_.begin()+_begin, index_.begin()+mid,
+		index_.begin()+_end, AxisLess(centers_, axis));
+
+	// children are stored next to each other
+	int child = (int)nodes_.size();
+	nodes_[_idx].child = child;
+	nodes_.push_back(Node());
+	nodes_.push_back(Node());
+
+	build(child,   _begin, mid);
+	build(child+1, mid,    _end);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void TriharmonicTreecode::set_weights(const std::vector<double>& _weights)
+{
+	int n = (int)centers_.size();
+	for (int i = 0; i < n; i++) {
+		weights_[i] = _weights[index_[i]];
+	}
+
+	int n_nodes = (int)nodes_.size();
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < n_nodes; i++) {
+		update_moments(nodes_[i]);
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void TriharmonicTreecode::update_moments(Node& _node) const
+{
+	int m;
+
+	for (m = 0; m < N_MOMENTS; m++) {
+		_node.moments[m] = 0;
+	}
+	_node.abs_weight = 0;
+
+	for (int i = _node.begin; i < _node.end; i++)
+	{
+		const Vec3f& c = centers_[i];
+		double w = weights_[i];
+		Vec3d  d = Vec3d(c[0], c[1], c[2]) - _node.center;
+		_node.abs_weight += fabs(w);
+
+		// powers d^0 .. d^4 of the three coordinates
+		double pow[3][5];
+		for (int k = 0; k < 3; k++) {
+			pow[k][0] = 1;
+			for (int e = 1; e < 5; e++) {
+				pow[k][e] = pow[k][e-1] * d[k];
+			}
+		}
+
+		for (m = 0; m < N_MOMENTS; m++) {
+			const int* e = monomials.exponent[m];
+			_node.moments[m] += w * pow[0][e[0]] * pow[1][e[1]] * pow[2][e[2]];
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+double TriharmonicTreecode::expansion(const Node& _node, const Vec3d& _p, double& _error) const
+{
+	// with u = y/|y| and s = u.d, the binomial series of
+	//   |y - d|^3 = r^3 (1 - 2s/r + |d|^2/r^2)^(3/2)
+	// sorted by powers of d gives
+	//   r^3
+	//   - 3 r^2 s
+	//   + 3/2 r (|d|^2 + s^2)
+	//   - 3/2 s |d|^2 + 1/2 s^3
+	//   + 3/8 (|d|^2 - s^2)^2 / r
+	Vec3d  y = _p - _node.center;
+	double r = y.norm();
+	Vec3d  u = y / r;
+
+	double pow[3][5];
+	for (int k = 0; k < 3; k++) {
+		pow[k][0] = 1;
+		for (int e = 1; e < 5; e++) {
+			pow[k][e] = pow[k][e-1] * u[k];
+		}
+	}
+
+	const double*    M   = _node.moments;
+	const int (*idx)[5][5] = monomials.index;
+
+	// sum w |d|^2 d and sum w |d|^2 |d|^2
+	Vec3d qd(M[idx[3][0][0]] + M[idx[1][2][0]] + M[idx[1][0][2]],
+		     M[idx[2][1][0]] + M[idx[0][3][0]] + M[idx[0][1][2]],
+		     M[idx[2][0][1]] + M[idx[0][2][1]] + M[idx[0][0][3]]);
+	double qq = M[idx[4][0][0]] + M[idx[0][4][0]] + M[idx[0][0][4]]
+		+ 2.0 * (M[idx[2][2][0]] + M[idx[2][0][2]] + M[idx[0][2][2]]);
+
+	double order0 = M[0] * r*r*r;
+	double order1 = -3.0 * r*r * contract(M, pow, 1);
+	double order2 = 1.5 * r * (M[idx[2][0][0]] + M[idx[0][2][0]] + M[idx[0][0][2]]
+		+ contract(M, pow, 2));
+	double order3 = -1.5 * (u | qd) + 0.5 * contract(M, pow, 3);
+	double qs     = contract(M, pow, 2, 2,0,0) + contract(M, pow, 2, 0,2,0)
+		+ contract(M, pow, 2, 0,0,2);
+	double order4 = 0.375 / r * (qq - 2.0 * qs + contract(M, pow, 4));
+
+	_error = std::max(fabs(order4), fabs(order3) * _node.radius / r);
+	return order0 + order1 + order2 + order3 + order4;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+double TriharmonicTreecode::operator()(const Vec3f& _p) const
+{
+	if (nodes_.empty()) {
+		return 0;
+	}
+
+	Vec3d  p(_p[0], _p[1], _p[2]);
+	double f(0);
+
+	// tolerance per unit of |w|, a cluster may contribute an error of
+	// its sum of |w_i| times this
+	double total = nodes_[0].abs_weight;
+	double tolerance = total > 0 ? tolerance_ / total : 0;
+
+	// the tree is balanced, so its depth is bounded by log2(n)+1
+	int stack[128];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node& node = nodes_[stack[--top]];
+		double r2  = (p - node.center).sqrnorm();
+		double rho = node.radius;
+
+		// far field: the series converges for rho/r < sqrt(2)-1, accept
+		// the expansion if its highest order terms are below the cluster's
+		// share of the tolerance
+		if (rho*rho < 0.16*r2)
+		{
+			double error;
+			double value = expansion(node, p, error);
+			if (error < tolerance * node.abs_weight) {
+				f += value;
+				continue;
+			}
+		}
+
+		// near field: sum up leaves directly
+		if (node.child < 0)
+		{
+			for (int i = node.begin; i < node.end; i++) {
+				double r = (Vec3d(centers_[i]) - p).norm();
+				f += weights_[i] * r*r*r;
+			}
+		}
+
+		else
+		{
+			stack[top++] = node.child;
+			stack[top++] = node.child+1;
+		}
+	}
+
+	return f;
+}
+
+
+//=============================================================================
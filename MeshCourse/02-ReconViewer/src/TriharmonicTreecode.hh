@@ -0,0 +1,97 @@
+//=============================================================================
+
+
+//=============================================================================
+
+
+#ifndef TRIHARMONIC_TREECODE_HH
+#define TRIHARMONIC_TREECODE_HH
+
+
+//=============================================================================
+
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <vector>
+
+//=============================================================================
+
+
+// Hierarchical (Barnes-Hut style) evaluation of the triharmonic RBF sum
+//
+//   f(x) = sum_i w_i |x - c_i|^3 .
+//
+// The centers are organized in a binary tree of bounding spheres. A cluster
+// of radius rho at distance r from the query point is replaced by the 4th
+// order Taylor expansion of |x - c|^3 around the cluster center. As the series
+// converges geometrically for rho/r < 0.4, the size of its highest order terms
+// estimates the truncation error; a cluster is only approximated if this
+// estimate is below its share of the user given tolerance, otherwise its
+// children are visited. The share is the tolerance scaled by the cluster's
+// part of sum_i |w_i|; the accepted clusters are disjoint, so the estimated
+// errors of an evaluation add up to at most the tolerance. For large point sets this makes an evaluation O(log n) instead of
+// O(n), below some 10k centers the direct sum is faster.
+//
+// Note that the weights of an RBF fit are large and cancel each other, so the
+// tolerance has to be small compared to the function values of interest.
+class TriharmonicTreecode
+{
+public:
+
+	typedef OpenMesh::Vec3f Vec3f;
+	typedef OpenMesh::Vec3d Vec3d;
+
+	TriharmonicTreecode() : tolerance_(0) {}
+
+	// build the cluster tree over _centers
+	void build(const std::vector<Vec3f>& _centers);
+
+	// set the weights of the centers and update the cluster expansions
+	void set_weights(const std::vector<double>& _weights);
+
+	// set the absolute error tolerance of an evaluation, split among the
+	// clusters in proportion to their sum of |w_i|
+	void set_tolerance(double _tolerance) { tolerance_ = _tolerance; }
+
+	// is the tree built?
+	bool empty() const { return nodes_.empty(); }
+
+	// evaluate the RBF sum at _p
+	double operator()(const Vec3f& _p) const;
+
+
+private:
+
+	// number of monomials x^a y^b z^c with a+b+c <= 4
+	enum { N_MOMENTS = 35 };
+
+	struct Node
+	{
+		int		begin, end;		// range of centers_
+		int		child;			// index of first child, -1 for leaves
+		Vec3d	center;			// expansion center
+		double	radius;			// bounding sphere radius around center
+		double	moments[N_MOMENTS];	// sum w_i d_i^a, d_i = c_i - center
+		double	abs_weight;		// sum |w_i|
+	};
+
+	void build(int _node, int _begin, int _end);
+	void update_moments(Node& _node) const;
+	double expansion(const Node& _node, const Vec3d& _p, double& _error) const;
+
+private:
+
+	enum { LEAF_SIZE = 16 };
+
+	double				tolerance_;
+	std::vector<Node>	nodes_;
+	std::vector<Vec3f>	centers_;	// centers in tree order
+	std::vector<int>	index_;		// original index of centers_[i]
+	std::vector<double>	weights_;	// weights in tree order
+};
+
+
+//=============================================================================
+#endif // TRIHARMONIC_TREECODE_HH defined
+//=============================================================================
+
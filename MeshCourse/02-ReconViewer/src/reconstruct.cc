@@ -7,27 +7,38 @@
 #include <OpenMesh/Tools/Utils/Timer.hh>
 
 #include <IsoEx/Grids/ScalarGridT.hh>
+#include <IsoEx/Grids/BrickedScalarGridT.hh>
+#include <IsoEx/Grids/NarrowBandSampler.hh>
 #include <IsoEx/Extractors/MarchingCubesT.hh>
+#include <IsoEx/Extractors/ParallelMarchingCubesT.hh>
+#include <IsoEx/Extractors/StreamingMarchingCubesT.hh>
+#include <IsoEx/Extractors/OFFStreamWriter.hh>
+#include <IsoEx/Extractors/TriangleBuffer.hh>
 
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <stdlib.h>
+#include <stdio.h>
 
 #include "ImplicitRBF.hh"
 #include "ImplicitMLS.hh"
-
-
-//=============================================================================
-
-
-// set to 1 for RBF fitting
-#define USE_RBF    1
-
-// else set this to 1 for RBF fitting
-#define USE_MLS  0
-
-// resolution of Marching Cubes grid
-#define MC_RESOLUTION  50
+#include "ImplicitPU.hh"
+#include "PointCloudIO.hh"
+#include "NormalEstimation.hh"
+#include "PointCloudSampling.hh"
+#include "GridCache.hh"
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#  include <psapi.h>
+#  pragma comment(lib, "psapi.lib")
+#endif
 
 
 //=============================================================================
@@ -42,119 +53,610 @@ typedef OpenMesh::Vec3d                   Vec3d;
 //=============================================================================
 
 
-int main(int argc, char **argv)
+// command line options
+struct Options
 {
-	// parse command line
-  int ExpectedNumberOfArguments = 3;
-#if USE_RBF
-  ExpectedNumberOfArguments = 4;
-#endif 
+	Options()
+		: method("rbf"), kernel("triharmonic"), epsilon(0.01f), betha(1.0f),
+		  resolution(50), treecode(0), greedy(0), far_field(0), solver(RBF_DENSE),
+		  narrow_band(false), stream(false), bricked(false), cutoff(3.0f),
+		  adaptive_k(0), leaf_size(32), normals_k(0),
+		  voxel(0), poisson_radius(0), poisson_count(0), cache(0), report(0) {}
+
+	std::string  method, kernel;
+	float        epsilon, betha;
+	int          resolution;
+	double       treecode, greedy, far_field;
+	RbfSolver    solver;
+	bool         narrow_band, stream, bricked;
+	float        cutoff;
+	int          adaptive_k, leaf_size, normals_k;
+	float        voxel, poisson_radius;
+	int          poisson_count;
+	const char*  cache;
+	const char*  report;
+	std::vector<const char*>  files;
+};
+
+
+void usage(const char* _name)
+{
+	std::cerr
+		<< "Usage: " << _name << " [options] <input-points> <output-mesh>\n"
+		<< "\n"
+		<< "  <input-points>       .pts, .ptsb or binary .ply, normals are estimated\n"
+		<< "                       if the file has none\n"
+		<< "  <output-mesh>        any format OpenMesh can write\n"
+		<< "\n"
+		<< "  -m, --method M       rbf, mls or pu (partition of unity) [rbf]\n"
+		<< "  -e, --epsilon E      off-surface distance of rbf and pu [0.01]\n"
+		<< "  -k, --kernel K       rbf kernel: triharmonic or bspline [triharmonic]\n"
+		<< "  -b, --betha B        support of the bspline kernel [1]\n"
+		<< "  -t, --treecode T     triharmonic treecode tolerance, 0 is exact [0]\n"
+		<< "  -g, --greedy G       rbf greedy center selection tolerance, 0 uses all [0]\n"
+		<< "  -s, --single         factorize the rbf system in single precision and refine\n"
+		<< "  -i, --iterative      solve the rbf system by matrix-free GMRES, O(n) memory\n"
+		<< "      --far-field F    relative treecode tolerance of the matrix-free products [0]\n"
+		<< "  -c, --cutoff C       mls cutoff in units of beta, 0 for none [3]\n"
+		<< "  -a, --adaptive-k K   mls bandwidth from the k-th neighbor, 0 is global [0]\n"
+		<< "  -l, --leaf-size L    max. points per pu octree cell [32]\n"
+		<< "  -r, --resolution R   marching cubes grid resolution [50]\n"
+		<< "  -n, --narrow-band    sample the grid close to the surface only, saves\n"
+		<< "                       evaluations from resolutions of about 60 on\n"
+		<< "      --stream         sample and extract slice by slice without storing the\n"
+		<< "                       grid, .off meshes are written while extracting\n"
+		<< "      --bricked        store the grid in 8x8x8 bricks, the extraction skips\n"
+		<< "                       bricks without surface\n"
+		<< "      --normals K      (re-)estimate normals from K neighbors [12 if missing]\n"
+		<< "      --voxel S        average the points in cubes of edge length S\n"
+		<< "      --poisson R      Poisson disk subset with minimum distance R\n"
+		<< "      --poisson-count N  Poisson disk subset with about N points\n"
+		<< "      --cache DIR      reuse sampled grids of identical fits stored in DIR\n"
+		<< "      --report FILE    write the timing report to FILE instead of stdout\n"
+		<< "  -h, --help\n";
+}
+
 
-	if (argc<ExpectedNumberOfArguments)
+// returns false on invalid arguments
+bool parse_options(int argc, char** argv, Options& _opt)
+{
+	for (int i = 1; i < argc; i++)
 	{
-		std::cerr << "Usage:\n" << argv[0] << "  <input-points>  <output-mesh> "; 
-#if USE_RBF
-    std::cerr << " <epsilon> "; 
+		std::string arg(argv[i]);
+
+		if (arg.size() < 2 || arg[0] != '-') {
+			_opt.files.push_back(argv[i]);
+			continue;
+		}
+		if (arg == "-h" || arg == "--help") {
+			return false;
+		}
+		if (arg == "-n" || arg == "--narrow-band") {
+			_opt.narrow_band = true;
+			continue;
+		}
+		if (arg == "--stream") {
+			_opt.stream = true;
+			continue;
+		}
+		if (arg == "--bricked") {
+			_opt.bricked = true;
+			continue;
+		}
+		if (arg == "-s" || arg == "--single") {
+			_opt.solver = RBF_DENSE_SINGLE;
+			continue;
+		}
+		if (arg == "-i" || arg == "--iterative") {
+			_opt.solver = RBF_MATRIX_FREE;
+			continue;
+		}
+
+		// all other options take a value
+		if (i+1 >= argc) {
+			std::cerr << "Missing value for " << arg << "\n";
+			return false;
+		}
+		const char* value = argv[++i];
+
+		if      (arg == "-m" || arg == "--method")      _opt.method = value;
+		else if (arg == "-k" || arg == "--kernel")      _opt.kernel = value;
+		else if (arg == "-e" || arg == "--epsilon")     _opt.epsilon = (float)atof(value);
+		else if (arg == "-b" || arg == "--betha")       _opt.betha = (float)atof(value);
+		else if (arg == "-t" || arg == "--treecode")    _opt.treecode = atof(value);
+		else if (arg == "-g" || arg == "--greedy")      _opt.greedy = atof(value);
+		else if (arg == "--far-field")                  _opt.far_field = atof(value);
+		else if (arg == "-c" || arg == "--cutoff")      _opt.cutoff = (float)atof(value);
+		else if (arg == "-a" || arg == "--adaptive-k")  _opt.adaptive_k = atoi(value);
+		else if (arg == "-l" || arg == "--leaf-size")   _opt.leaf_size = atoi(value);
+		else if (arg == "-r" || arg == "--resolution")  _opt.resolution = atoi(value);
+		else if (arg == "--normals")                    _opt.normals_k = atoi(value);
+		else if (arg == "--voxel")                      _opt.voxel = (float)atof(value);
+		else if (arg == "--poisson")                    _opt.poisson_radius = (float)atof(value);
+		else if (arg == "--poisson-count")              _opt.poisson_count = atoi(value);
+		else if (arg == "--cache")                      _opt.cache = value;
+		else if (arg == "--report")                     _opt.report = value;
+		else {
+			std::cerr << "Unknown option " << arg << "\n";
+			return false;
+		}
+	}
+
+	if (_opt.files.size() != 2) {
+		return false;
+	}
+	if (_opt.method != "rbf" && _opt.method != "mls" && _opt.method != "pu") {
+		std::cerr << "Unknown method " << _opt.method << "\n";
+		return false;
+	}
+	if (_opt.kernel != "triharmonic" && _opt.kernel != "bspline") {
+		std::cerr << "Unknown kernel " << _opt.kernel << "\n";
+		return false;
+	}
+	if ((_opt.voxel > 0) + (_opt.poisson_radius > 0) + (_opt.poisson_count > 0) > 1) {
+		std::cerr << "Choose one of --voxel, --poisson and --poisson-count\n";
+		return false;
+	}
+	if (_opt.voxel < 0 || _opt.poisson_radius < 0 || _opt.poisson_count < 0) {
+		std::cerr << "Invalid downsampling parameter\n";
+		return false;
+	}
+	if (_opt.stream && (_opt.narrow_band || _opt.cache)) {
+		std::cerr << "--stream cannot be combined with --narrow-band or --cache\n";
+		return false;
+	}
+	if (_opt.bricked && (_opt.stream || _opt.narrow_band || _opt.cache)) {
+		std::cerr << "--bricked cannot be combined with --stream, --narrow-band or --cache\n";
+		return false;
+	}
+	if (_opt.normals_k < 0) {
+		std::cerr << "Invalid number of normal estimation neighbors\n";
+		return false;
+	}
+	if (_opt.resolution < 2 || _opt.epsilon <= 0 || _opt.betha <= 0) {
+		std::cerr << "Invalid resolution, epsilon or betha\n";
+		return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// current and peak resident set size in MB, 0 if unknown
+void memory_usage(double& _rss, double& _peak)
+{
+	_rss = _peak = 0;
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+		_rss  = pmc.WorkingSetSize / 1048576.0;
+		_peak = pmc.PeakWorkingSetSize / 1048576.0;
+	}
+#else
+	// Linux only, other systems report 0
+	FILE* status = fopen("/proc/self/status", "r");
+	if (status) {
+		char line[256];
+		double kb;
+		while (fgets(line, sizeof(line), status)) {
+			if (sscanf(line, "VmRSS: %lf", &kb) == 1) _rss  = kb / 1024.0;
+			if (sscanf(line, "VmHWM: %lf", &kb) == 1) _peak = kb / 1024.0;
+		}
+		fclose(status);
+	}
 #endif
-    std::cerr << endl;
-		exit(1);
+}
+
+
+// timing and memory of the pipeline stages
+class StageReport
+{
+public:
+
+	// start the timer of stage _name
+	void begin(const char* _name)
+	{
+		std::cerr << _name << "\n" << std::flush;
+		name_ = _name;
+		timer_.reset();
+		timer_.start();
+	}
+
+	// stop the current stage and record its time and memory
+	void end()
+	{
+		timer_.stop();
+		Stage s;
+		s.name = name_;
+		s.seconds = timer_.seconds();
+		memory_usage(s.rss, s.peak);
+		stages_.push_back(s);
+	}
+
+	// additional key/value results
+	void value(const char* _key, double _value)
+	{
+		values_.push_back(std::make_pair(std::string(_key), _value));
+	}
+
+	// tab separated table, one line per stage, then the values
+	void write(std::ostream& _os) const
+	{
+		double total(0), rss, peak;
+		_os << "stage\tseconds\trss_mb\tpeak_rss_mb\n";
+		for (unsigned int i = 0; i < stages_.size(); i++) {
+			const Stage& s = stages_[i];
+			_os << s.name << "\t" << s.seconds << "\t" << s.rss << "\t" << s.peak << "\n";
+			total += s.seconds;
+		}
+		memory_usage(rss, peak);
+		_os << "total\t" << total << "\t" << rss << "\t" << peak << "\n";
+
+		for (unsigned int i = 0; i < values_.size(); i++) {
+			_os << values_[i].first << "\t" << values_[i].second << "\n";
+		}
 	}
 
-	// load sample points with normals
-	std::cout << "Load points\n" << std::flush;
+private:
+
+	struct Stage
+	{
+		std::string  name;
+		double       seconds, rss, peak;
+	};
+
+	OpenMesh::Utils::Timer  timer_;
+	std::string             name_;
+	std::vector<Stage>      stages_;
+	std::vector< std::pair<std::string, double> >  values_;
+};
+
+
+//-----------------------------------------------------------------------------
+
 
-	std::ifstream ifs(argv[1]);
-	if (!ifs) 
+// RBF fit with the kernel type chosen at compile time
+template <class Kernel>
+Implicit* fit_rbf(const std::vector<OpenMesh::Vec3f>& _points,
+				  const std::vector<OpenMesh::Vec3f>& _normals,
+				  Options& _opt, const Kernel& _kernel, StageReport& _report)
+{
+	ImplicitRBFT<Kernel>* rbf = new ImplicitRBFT<Kernel>( _points, _normals,
+		_opt.epsilon, _kernel, _opt.greedy, _opt.solver, _opt.far_field );
+	rbf->use_treecode(_opt.treecode);
+	_report.value("residual", rbf->residual());
+	if (!rbf->converged())
 	{
-		std::cerr << "Cannot open file\n";
+		std::cerr << "The RBF fit did not converge\n";
 		exit(1);
 	}
+	return (Implicit*) rbf;
+}
 
-	std::vector<Point>   points, normals;
-	Point                p, n;
 
-	while (ifs && !ifs.eof())
+// fit the implicit function of the chosen method to the samples
+Implicit* fit_implicit(const std::vector<OpenMesh::Vec3f>& _points,
+					   const std::vector<OpenMesh::Vec3f>& _normals,
+					   Options& _opt, StageReport& _report)
+{
+	if (_opt.method == "mls")
+	{
+		return (Implicit*) new ImplicitMLS( _points, _normals, _opt.cutoff,
+			_opt.adaptive_k );
+	}
+	else if (_opt.method == "pu")
+	{
+		return (Implicit*) new ImplicitPU( _points, _normals, _opt.epsilon,
+			_opt.leaf_size );
+	}
+	else if (_opt.kernel == "bspline")
 	{
-		ifs >> p[0] >> p[1] >> p[2];
-		ifs >> n[0] >> n[1] >> n[2];
-		points.push_back(p);
-		normals.push_back(n);
+		return fit_rbf(_points, _normals, _opt, CubicBSplineRbf(_opt.betha), _report);
 	}
-	std::cout << points.size() << " sample points\n";
-	ifs.close();
+	return fit_rbf(_points, _normals, _opt, TriharmonicRbf(), _report);
+}
 
 
+// cache key of the sampled grid, hashes the parameters of the chosen method
+uint64_t grid_key(const std::vector<OpenMesh::Vec3f>& _points,
+				  const std::vector<OpenMesh::Vec3f>& _normals,
+				  const Options& _opt)
+{
+	// narrow band grids may miss surface components of the dense grid, see
+	// IsoEx::NarrowBandSamplerT, they are cached separately
+	GridKey key;
+	key << _points << _normals << _opt.method << _opt.resolution
+		<< (int)_opt.narrow_band;
+
+	if (_opt.method == "mls")
+		key << _opt.cutoff << _opt.adaptive_k;
+	else if (_opt.method == "pu")
+		key << _opt.epsilon << _opt.leaf_size;
+	else
+		key << _opt.kernel << _opt.epsilon << _opt.betha << _opt.treecode
+			<< _opt.greedy << (int)_opt.solver << _opt.far_field;
+
+	return key.value();
+}
 
 
-	// fit RBF to constraints
-#if USE_RBF
-	std::cout << "Fit RBF\n" << std::flush;
-  float epsilon = atof(argv[3]);
-	ImplicitRBF   implicit( points, normals, epsilon );
-#elif USE_MLS
-	std::cout << "Use MLS method\n" << std::flush;
-	ImplicitMLS implicit( points, normals );
-#else
-#error(You have to set either USE_RBF or USE_MLS to 1)
-#endif
+//=============================================================================
 
 
-  // compute bounding cube for Marching Cubes grid
-  std::cout << "Bounding Box\n" << std::flush;
-  Point bb_min( points[0]), bb_max( points[0]);
+int main(int argc, char **argv)
+{
+	// parse command line
+	Options opt;
+	if (!parse_options(argc, argv, opt))
+	{
+		usage(argv[0]);
+		exit(1);
+	}
 
-  for (unsigned int i=1; i<points.size(); ++i)
-  {
-      bb_min.minimize( points[i] );
-      bb_max.maximize( points[i] );
-  }
+	// progress messages of the library code go to stderr, stdout only
+	// gets the report
+	std::streambuf* stdout_buf = std::cout.rdbuf(std::cerr.rdbuf());
+	StageReport report;
 
-  Point  bb_center = (bb_max+bb_min)*0.5f;
-  Vec3d VecDiag(bb_max[0]-bb_min[0], bb_max[1]-bb_min[1], bb_max[2]-bb_min[2]);
-  bb_min = bb_center - 0.6f * Point(VecDiag[0], VecDiag[1], VecDiag[2]);
-  bb_max = bb_center + 0.6f * Point(VecDiag[0], VecDiag[1], VecDiag[2]);
 
-  // setup Marching Cubes grid by sampling RBF
-  std::cout << "Setup grid\n" << std::flush;
-  
-  float MeanSize = VecDiag.mean();
-	int res[3];
-  int idir;
-  for (idir=0; idir<3; idir++)
-  {
-    res[idir] = (int)(MC_RESOLUTION * VecDiag[0]/MeanSize + 0.5); 
-  }
-	IsoEx::ScalarGridT<Scalar>  grid(bb_min,
-		Point(bb_max[0]-bb_min[0], 0, 0),
-		Point(0, bb_max[1]-bb_min[1], 0),
-		Point(0, 0, bb_max[2]-bb_min[2]),
-		res[0], res[1], res[2]);
+	// load sample points, with or without normals
+	report.begin("load");
+	std::vector<Point>   points, normals;
+	if (!read_point_cloud(opt.files[0], points, normals))
+	{
+		exit(1);
+	}
+	report.end();
+
+	std::cerr << points.size() << " sample points\n";
+	if (points.empty())
+	{
+		std::cerr << "Need a non-empty point cloud\n";
+		exit(1);
+	}
+	report.value("points", (double)points.size());
 
-	for (unsigned int x=0; x<res[0]; ++x)
-		for (unsigned int y=0; y<res[1]; ++y)
-			for (unsigned int z=0; z<res[2]; ++z)
-				grid.value(x,y,z) = implicit( grid.point(x,y,z) );
 
+	// estimate oriented normals if there are none or if requested
+	if (normals.empty() || opt.normals_k > 0)
+	{
+		int k = (opt.normals_k > 0) ? opt.normals_k : 12;
+		report.begin("normals");
+		int components = estimate_normals(points, k, normals);
+		report.end();
+		report.value("normal_components", (double)components);
+		if (components > 1)
+		{
+			std::cerr << "Warning: the " << k << "-neighbor graph has "
+					  << components << " components, their normals are oriented independently\n";
+		}
+	}
 
 
+	// downsample oversampled input, after the normal estimation so that it
+	// still sees the full neighborhoods
+	if (opt.voxel > 0 || opt.poisson_radius > 0 || opt.poisson_count > 0)
+	{
+		report.begin("downsample");
+		std::vector<Point> sub_points, sub_normals;
+		if (opt.voxel > 0)
+			voxel_downsample(points, normals, opt.voxel, sub_points, sub_normals);
+		else if (opt.poisson_radius > 0)
+			poisson_disk_downsample(points, normals, opt.poisson_radius, sub_points, sub_normals);
+		else
+			report.value("poisson_radius", poisson_disk_downsample_count(points, normals,
+				opt.poisson_count, sub_points, sub_normals));
+		points.swap(sub_points);
+		normals.swap(sub_normals);
+		report.end();
+
+		std::cerr << points.size() << " points after downsampling\n";
+		report.value("downsampled_points", (double)points.size());
+	}
 
-	// isosurface extraction by Marching Cubes
-	std::cout << "Marching Cubes\n" << std::flush;
-	Mesh mesh;
-	marching_cubes(grid, mesh); 
 
+	// compute bounding cube for Marching Cubes grid
+	Point bb_min( points[0]), bb_max( points[0]);
+	for (unsigned int i=1; i<points.size(); ++i)
+	{
+		bb_min.minimize( points[i] );
+		bb_max.maximize( points[i] );
+	}
 
+	Point  bb_center = (bb_max+bb_min)*0.5f;
+	Vec3d VecDiag(bb_max[0]-bb_min[0], bb_max[1]-bb_min[1], bb_max[2]-bb_min[2]);
+	bb_min = bb_center - 0.6f * Point(VecDiag[0], VecDiag[1], VecDiag[2]);
+	bb_max = bb_center + 0.6f * Point(VecDiag[0], VecDiag[1], VecDiag[2]);
 
-	// write mesh
-	std::cout << "Write mesh\n" << std::flush;
-	if (!OpenMesh::IO::write_mesh(mesh, argv[2]))
+	// resolution proportional to the extent of each axis
+	float MeanSize = VecDiag.mean();
+	int res[3];
+	for (int idir=0; idir<3; idir++)
 	{
-		std::cerr << "Cannot write mesh\n";
-		exit(1);
+		res[idir] = std::max(2, (int)(opt.resolution * VecDiag[idir]/MeanSize + 0.5));
+	}
+	Point x_axis(bb_max[0]-bb_min[0], 0, 0);
+	Point y_axis(0, bb_max[1]-bb_min[1], 0);
+	Point z_axis(0, 0, bb_max[2]-bb_min[2]);
+	report.value("grid_points", (double)res[0] * res[1] * res[2]);
+
+
+	Mesh mesh;
+	bool written = false;
+	if (opt.stream)
+	{
+		// the grid is never stored, sampling and extraction are interleaved
+		report.begin("fit");
+		Implicit* implicit = fit_implicit(points, normals, opt, report);
+		report.end();
+
+		report.begin("extract");
+		std::string out(opt.files[1]);
+		bool off = out.size() > 4 &&
+			(out.substr(out.size()-4) == ".off" || out.substr(out.size()-4) == ".OFF");
+		if (off)
+		{
+			// straight to the file, the mesh is never stored either
+			IsoEx::OFFStreamWriter writer(opt.files[1]);
+			if (!writer.is_open())
+			{
+				std::cerr << "Cannot write mesh\n";
+				exit(1);
+			}
+			streaming_marching_cubes(*implicit, bb_min, x_axis, y_axis, z_axis,
+				res[0], res[1], res[2], writer);
+			report.value("vertices", writer.n_vertices());
+			report.value("faces", writer.n_faces());
+			if (!writer.close())
+			{
+				std::cerr << "Cannot write mesh\n";
+				exit(1);
+			}
+		}
+		else
+		{
+			IsoEx::MeshOutputT<Mesh> output(mesh);
+			streaming_marching_cubes(*implicit, bb_min, x_axis, y_axis, z_axis,
+				res[0], res[1], res[2], output);
+		}
+		report.end();
+		report.value("evaluations", (double)res[0] * res[1] * res[2]);
+		delete implicit;
+		written = off;
+	}
+	else if (opt.bricked)
+	{
+		// bricked, Morton-ordered grid: the corners of a cube share few
+		// cache lines and the extraction skips the bricks without surface
+		report.begin("fit");
+		Implicit* implicit = fit_implicit(points, normals, opt, report);
+		report.end();
+
+		IsoEx::BrickedScalarGridT<Scalar>  grid(bb_min, x_axis, y_axis, z_axis,
+			res[0], res[1], res[2]);
+		report.begin("sample");
+		grid.sample_function(*implicit);
+		report.value("evaluations", (double)grid.n_points());
+		report.end();
+		delete implicit;
+
+		IsoEx::TriangleBuffer triangles;
+		report.begin("extract");
+		marching_cubes(grid, triangles);
+		report.end();
+
+		report.begin("connect");
+		triangles.to_mesh(mesh);
+		report.end();
+	}
+	else
+	{
+		IsoEx::ScalarGridT<Scalar>  grid(bb_min, x_axis, y_axis, z_axis,
+			res[0], res[1], res[2]);
+
+
+		// a cached grid of an identical fit makes fitting and sampling obsolete
+		uint64_t key = 0;
+		bool cached = false;
+		if (opt.cache)
+		{
+			report.begin("cache");
+			key = grid_key(points, normals, opt);
+			cached = GridCache(opt.cache).load(key, grid);
+			report.end();
+			report.value("cache_hit", cached);
+		}
+
+
+		std::vector<IsoEx::Grid::CubeIdx> cubes;
+		if (!cached)
+		{
+			// fit implicit function to the samples
+			report.begin("fit");
+			Implicit* implicit = fit_implicit(points, normals, opt, report);
+			report.end();
+
+
+			// sample the implicit function in parallel
+			report.begin("sample");
+			if (opt.narrow_band)
+			{
+				unsigned int n = IsoEx::sample_narrow_band(grid, *implicit, 0, cubes);
+				report.value("evaluations", n);
+				report.value("active_cubes", (double)cubes.size());
+			}
+			else
+			{
+				grid.sample_function(*implicit);
+				report.value("evaluations", (double)grid.n_points());
+			}
+			report.end();
+			delete implicit;
+
+			// culled blocks of narrow band grids are constant, so full
+			// Marching Cubes extracts the same mesh from a cached one
+			if (opt.cache && !GridCache(opt.cache).store(key, grid))
+			{
+				std::cerr << "Cannot write " << GridCache(opt.cache).filename(key) << "\n";
+			}
+		}
+
+
+		// isosurface extraction by Marching Cubes into flat arrays, the
+		// halfedge connectivity is built for all triangles at once
+		IsoEx::TriangleBuffer triangles;
+		report.begin("extract");
+		if (opt.narrow_band && !cached)
+		{
+			marching_cubes(grid, cubes, triangles);
+		}
+		else
+		{
+			parallel_marching_cubes(grid, triangles);
+		}
+		report.end();
+
+		report.begin("connect");
+		triangles.to_mesh(mesh);
+		report.end();
+	}
+
+
+	// write mesh, unless it has been streamed to the file already
+	if (!written)
+	{
+		report.value("vertices", mesh.n_vertices());
+		report.value("faces", mesh.n_faces());
+
+		report.begin("write");
+		if (!OpenMesh::IO::write_mesh(mesh, opt.files[1]))
+		{
+			std::cerr << "Cannot write mesh\n";
+			exit(1);
+		}
+		report.end();
 	}
 
 
-	std::cout << "Done\n" << std::flush;
+	// timing and memory report
+	if (opt.report)
+	{
+		std::ofstream ofs(opt.report);
+		report.write(ofs);
+		if (!ofs)
+		{
+			std::cerr << "Cannot write report\n";
+			exit(1);
+		}
+	}
+	else
+	{
+		std::cout.rdbuf(stdout_buf);
+		report.write(std::cout);
+	}
+
 	exit(0);
 }
 
@@ -43,6 +43,7 @@
 #include <float.h>
 #include <windows.h>
 #include "DecimationViewer.hh"
+#include <IsoEx/Math/LDLTSolverT.hh>
 
 
 DecimationViewer::DecimationViewer(const char* _title, int _width, int _height) :
@@ -312,9 +313,13 @@ void DecimationViewer::decimate(unsigned int _n_vertices)
 // From HW2
 void DecimationViewer::solve_linear_system( gmmMatrix& _M, gmmVector& _b, gmmVector& _x)
 {
-	// solve linear system by gmm's LU factorization
 	unsigned int N = _b.size();
 	_x.resize(N);
+	// the quadric's system is symmetric up to its last row (0,0,0,1)
+	if (IsoEx::Math::solve_symmetric(_M, N, _x, _b)) {
+		return;
+	}
+	// otherwise solve linear system by gmm's LU factorization
 	std::vector< size_t >  ipvt(N);
 	gmm::lu_factor( _M, ipvt );
 	gmm::lu_solve( _M, ipvt, _x, _b );
@@ -1,4 +1,5 @@
 #include "HarmonicMapViewer.hh"
+#include <IsoEx/Math/LDLTSolverT.hh>
 #include <windows.h>
 #include <iostream>
 #include <fstream>
@@ -522,6 +523,11 @@ void HarmonicMapViewer::solve_linear_system( gmmMatrix& _M, gmmVector& _b, gmmVe
 {
 	unsigned int N = _b.size();
 	_x.resize(N);
+	// with symmetric edge weights the system is symmetric up to the boundary
+	// rows, which are rows of the identity
+	if (IsoEx::Math::solve_symmetric(_M, N, _x, _b)) {
+		return;
+	}
 	std::vector< size_t >  ipvt(N);
 	gmm::lu_factor( _M, ipvt );
 	gmm::lu_solve( _M, ipvt, _x, _b );
@@ -29,11 +29,14 @@
 
 #include <IsoEx/Implicits/ImplicitSphere.hh>
 #include <IsoEx/Implicits/CSG.hh>
+#include <IsoEx/Implicits/CompiledCSG.hh>
 
 #include <IsoEx/Grids/ImplicitGrid.hh>
 
 #include <IsoEx/Extractors/MarchingCubesT.hh>
 #include <IsoEx/Extractors/ExtendedMarchingCubesT.hh>
+#include <IsoEx/Extractors/StreamingMarchingCubesT.hh>
+#include <IsoEx/Extractors/OFFStreamWriter.hh>
 
 #include <unistd.h>
 
@@ -65,10 +68,12 @@ typedef TriMesh_ArrayKernelT<MyTraits>  MyMesh;
 void usage(const char* _argv0)
 {
   std::cerr << "\n\nUsage: \n"
-	    << _argv0 << "  <-e | -m> <-a angle> <-r resolution> <-o filename> \n\n";
+	    << _argv0 << "  <-e | -m | -s> <-a angle> <-r resolution> <-o filename> \n\n";
   
   std::cerr << "  -e   Use Extended Marching Cubes (default)\n"
 	    << "  -m   Use standard Marching Cubes\n"
+	    << "  -s   Use standard Marching Cubes slice by slice, without storing\n"
+	    << "       the grid (nor the mesh for *.off), any resolution\n"
 	    << "  -a   Feature detection threshold\n"
 	    << "  -r   Grid resolution (default is 50)\n"
 	    << "  -o   Write result to filename (should be *.{off,obj,stl}), "
@@ -87,7 +92,7 @@ int main(int argc, char** argv)
   // parameters
   const char*       filename = "output.off";
   unsigned int      res      = 50;
-  enum { MC, EMC }  mode     = EMC;
+  enum { MC, EMC, SMC }  mode = EMC;
   float             angle    = 30.0;
 
 
@@ -97,7 +102,7 @@ int main(int argc, char** argv)
   extern char *optarg;
   //extern int  optind;
 
-  while ((c = getopt(argc, argv, "a:ehmo:r:")) != -1)
+  while ((c = getopt(argc, argv, "a:ehmo:r:s")) != -1)
   {
     switch (c)
     {
@@ -119,6 +124,12 @@ int main(int argc, char** argv)
 	break;
       }
 
+      case 's':
+      {
+	mode = SMC;
+	break;
+      }
+
       case 'o':
       {
 	filename = optarg;
@@ -149,6 +160,10 @@ int main(int argc, char** argv)
       std::cout << "Standard Marching Cubes\n"; 
       break;
 
+    case SMC:
+      std::cout << "Streaming Marching Cubes\n";
+      break;
+
     case EMC: 
       std::cout << "Extended Marching Cubes\n"
 		<< "Feature detection angle: " << angle 
@@ -168,10 +183,43 @@ int main(int argc, char** argv)
   CSG::Union         i1(s1, s2);
   CSG::Difference    i2(i1, s3);
 
+  // evaluate the tree as a flat program
+  CompiledCSG        csg(i2);
+
+
+
+  // streaming extraction, the grid is never stored
+  if (mode == SMC)
+  {
+    std::string name(filename);
+    if (name.size() > 4 && name.substr(name.size()-4) == ".off")
+    {
+      OFFStreamWriter writer(filename);
+      streaming_marching_cubes(ScalarDistanceFunc(csg),
+			       Vec3f(-2,-2,-2), Vec3f(4,0,0), Vec3f(0,4,0), Vec3f(0,0,4),
+			       res, res, res, writer);
+      if (!writer.close())
+      {
+	std::cerr << "Cannot write " << filename << std::endl;
+	return 1;
+      }
+    }
+    else
+    {
+      MyMesh            mesh;
+      MeshOutputT<MyMesh>  output(mesh);
+      streaming_marching_cubes(ScalarDistanceFunc(csg),
+			       Vec3f(-2,-2,-2), Vec3f(4,0,0), Vec3f(0,4,0), Vec3f(0,0,4),
+			       res, res, res, output);
+      write_mesh(mesh, filename);
+    }
+    return 0;
+  }
+
 
 
   // define the grid
-  ImplicitGrid grid(i2,               // implicit
+  ImplicitGrid grid(csg,              // implicit
 		    Vec3f(-2,-2,-2),  // origin
 		    Vec3f(4,0,0),     // x-axis
 		    Vec3f(0,4,0),     // y-axis
@@ -191,8 +239,16 @@ int main(int argc, char** argv)
       break;
 
     case EMC:
+    {
+      // visit only the cubes the surface passes through
+      std::vector<Grid::CubeIdx> cubes;
       grid.build_is_inside_cache();
-      extended_marching_cubes(grid, mesh, angle);
+      grid.active_cubes(cubes);
+      extended_marching_cubes(grid, cubes, mesh, angle);
+      break;
+    }
+
+    case SMC:  // extracted above
       break;
   }
 
@@ -36,7 +36,8 @@
 
 //== INCLUDES =================================================================
 
-#include <map>
+#include <cstddef>
+#include <vector>
 
 //== NAMESPACES ===============================================================
 
@@ -46,12 +47,15 @@ namespace IsoEx {
 
 /** \class Edge2VertexMapT Edge2VertexMapT.hh <IsoEx/Extractors/Edge2VertexMapT.hh>
 
-    This class map edges (referenced by a point index and an axis) to
+    This class map edges (referenced by their two end points) to
     vertex handles. Both PointIdx and VertexHandle are template
-    arguments.  Internally this is implemented using a std::map, the
-    key is a combination of point and axis index, the value is a
-    VertexHandle.
-    \note PointIdx must be comparable, i.e. have operator<().
+    arguments.  Internally this is an open addressing hash table with
+    linear probing, the key packs the sorted point indices into 64 bits,
+    the value is a VertexHandle. The table is doubled when it is half
+    full, so lookups and insertions take O(1) and the memory is
+    proportional to the number of stored edges, i.e. to the size of the
+    extracted mesh, not to the size of the grid.
+    \note PointIdx must be an unsigned integer type of at most 32 bits.
 */	      
 
 template <class PointIdx, class VertexHandle>
@@ -60,55 +64,112 @@ class Edge2VertexMapT
 public:
    
   /// Constructor
-  Edge2VertexMapT() {}
+  Edge2VertexMapT() { reset(); }
 
 
   /// clear the map
-  void clear() { map_.clear(); }
+  void clear() { reset(); }
 
   /// Store vertex in map
   void insert(PointIdx _p0, PointIdx _p1, VertexHandle _vhnd)
   {
-    map_[EdgeKey(_p0, _p1)] = _vhnd;
+    (*this)(_p0, _p1) = _vhnd;
   }
 
   /// Get vertex handle from map. Returns invalid handle if not found.
   VertexHandle find(PointIdx _p0, PointIdx _p1) const 
   {
-    MyMapIterator it = map_.find(EdgeKey(_p0, _p1));
-    if (it != map_.end())  return it->second;
-    else return VertexHandle();
+    const Key key = make_key(_p0, _p1);
+    for (std::size_t i = slot(key); ; i = (i+1) & mask_)
+    {
+      if (keys_[i] == key)    return values_[i];
+      if (keys_[i] == empty_key())  return VertexHandle();
+    }
   }
 
+  /** Vertex handle stored for the edge, for new edges an invalid handle
+      is inserted that can be assigned to. Saves the second lookup of
+      find() followed by insert(). The reference is valid until the next
+      insertion. */
+  VertexHandle& operator()(PointIdx _p0, PointIdx _p1)
+  {
+    if (2*(size_+1) > keys_.size())  grow();
+    const Key key = make_key(_p0, _p1);
+    std::size_t i = slot(key);
+    for (; keys_[i] != key; i = (i+1) & mask_)
+    {
+      if (keys_[i] == empty_key())
+      {
+        keys_[i]   = key;
+        values_[i] = VertexHandle();
+        ++size_;
+        break;
+      }
+    }
+    return values_[i];
+  }
+
+  /// Number of stored edges
+  std::size_t size() const { return size_; }
+
 
 private:
 
-  class EdgeKey 
+  typedef unsigned long long  Key;
+
+  // no edge connects a point to itself, so (p,p) is never a valid key
+  static Key empty_key() { return ~Key(0); }
+
+  static Key make_key(PointIdx _p0, PointIdx _p1)
   {
-  public:
+    return (_p0 < _p1) ? (Key(_p0) << 32 | Key(_p1)) : (Key(_p1) << 32 | Key(_p0));
+  }
 
-    EdgeKey(PointIdx _p0, PointIdx _p1) {
-      if (_p0 < _p1)  { p0_ = _p0;  p1_ = _p1; }
-      else            { p0_ = _p1;  p1_ = _p0; }
-    }
+  // Fibonacci hashing, the high bits of the product are well mixed
+  std::size_t slot(Key _key) const
+  {
+    return std::size_t((_key * 0x9E3779B97F4A7C15ULL) >> shift_);
+  }
+
+  // the smallest table, two empty slots, so find() needs no special case
+  void reset()
+  {
+    keys_.assign(2, empty_key());
+    values_.assign(2, VertexHandle());
+    size_  = 0;
+    mask_  = 1;
+    shift_ = 63;
+  }
 
-    bool operator<(const EdgeKey& _rhs) const 
+  void grow()
+  {
+    std::vector<Key>           keys;
+    std::vector<VertexHandle>  values;
+    keys.swap(keys_);
+    values.swap(values_);
+
+    std::size_t capacity = keys.size() < 512 ? 1024 : 2*keys.size();
+    keys_.assign(capacity, empty_key());
+    values_.resize(capacity);
+    mask_  = capacity - 1;
+    shift_ = 64;
+    while (capacity > 1) { capacity >>= 1; --shift_; }
+
+    for (std::size_t j = 0; j < keys.size(); ++j)
     {
-      if (p0_ != _rhs.p0_)
-	return (p0_ < _rhs.p0_);
-      else
-	return (p1_ < _rhs.p1_);
+      if (keys[j] == empty_key())  continue;
+      std::size_t i = slot(keys[j]);
+      while (keys_[i] != empty_key())  i = (i+1) & mask_;
+      keys_[i]   = keys[j];
+      values_[i] = values[j];
     }
+  }
 
-  private:
-    PointIdx p0_, p1_;
-  };
-
-
-  typedef std::map<EdgeKey, VertexHandle>  MyMap;
-  typedef typename MyMap::const_iterator   MyMapIterator;
 
-  MyMap  map_;
+  std::vector<Key>           keys_;
+  std::vector<VertexHandle>  values_;
+  std::size_t                size_, mask_;
+  int                        shift_;
 };
 
 
@@ -35,6 +35,7 @@
 
 #include <IsoEx/Extractors/ExtendedMarchingCubesT.hh>
 #include <IsoEx/Extractors/MCTables.hh>
+#include <algorithm>
 #include <IsoEx/Math/MatrixT.hh>
 #include <IsoEx/Math/svd.hh>
 #include <vector>
@@ -58,9 +59,39 @@ ExtendedMarchingCubesT(const Grid&  _grid,
     n_edges_(0),
     n_corners_(0)
 {
-  CubeIterator cube_it(grid_.begin()), cube_end(grid_.end());
-  for (; cube_it!=cube_end; ++cube_it)
-    process_cube(*cube_it);
+  const unsigned int n_cubes(grid_.n_cubes()), block(grid_.block_size());
+  for (CubeIdx first=0; first<n_cubes; first+=block)
+  {
+    if (grid_.is_empty_block(first))
+      continue;
+
+    const CubeIdx last = std::min(first+block, n_cubes);
+    for (CubeIdx idx=first; idx<last; ++idx)
+      process_cube(idx);
+  }
+
+  flip_edges();
+
+  std::cerr << "Found "
+	    << n_edges_ << " edge features, " 
+	    << n_corners_ << " corner features\n";
+}
+
+
+template <class Mesh>
+ExtendedMarchingCubesT<Mesh>::
+ExtendedMarchingCubesT(const Grid&                        _grid,
+		       const std::vector<Grid::CubeIdx>&  _cubes,
+		       Mesh&                              _mesh,
+		       double                             _feature_angle)
+  : grid_(_grid),
+    mesh_(_mesh),
+    feature_angle_(_feature_angle / 180.0 * M_PI),
+    n_edges_(0),
+    n_corners_(0)
+{
+  for (unsigned int i=0; i<_cubes.size(); ++i)
+    process_cube(_cubes[i]);
 
   flip_edges();
 
@@ -89,9 +120,13 @@ process_cube(CubeIdx _idx)
 
 
 
+  // skip padding of e.g. bricked grids
+  if (!grid_.is_valid(_idx))
+    return;
+
+
   // get corner vertices
-  for (i=0; i<8; ++i)
-    corner[i] = grid_.point_idx(_idx, i);
+  grid_.point_indices(_idx, corner);
 
 
   // determine cube type
@@ -172,8 +207,9 @@ typename ExtendedMarchingCubesT<Mesh>::VertexHandle
 ExtendedMarchingCubesT<Mesh>::
 add_vertex(PointIdx _p0, PointIdx _p1)
 {
-  // find vertex if it has been computed already
-  VertexHandle   vh = edge2vertex_.find(_p0, _p1);
+  // find vertex if it has been computed already, otherwise the new
+  // vertex is stored in the map's slot for this edge
+  VertexHandle&  vh = edge2vertex_(_p0, _p1);
   if (vh.is_valid())  return vh;
 
 
@@ -198,7 +234,6 @@ add_vertex(PointIdx _p0, PointIdx _p1)
   // add vertex
   vh = mesh_.add_vertex(point);
   mesh_.set_normal(vh, normal);
-  edge2vertex_.insert(_p0, _p1, vh);
 
 
   return vh;
@@ -67,6 +67,12 @@ public:
 			 Mesh&        _mesh,
 			 double       _feature_angle);
 
+  /// Process the cubes \b _cubes only, e.g. ImplicitGrid::active_cubes()
+  ExtendedMarchingCubesT(const Grid&                        _grid,
+			 const std::vector<Grid::CubeIdx>&  _cubes,
+			 Mesh&                              _mesh,
+			 double                             _feature_angle);
+
   
 private:
 
@@ -113,6 +119,21 @@ void extended_marching_cubes(const Grid&  _grid,
 }
 
 
+/** Convenience wrapper for the Extended Marching Cubes algorithm
+    restricted to the cubes \b _cubes, see ImplicitGrid::active_cubes().
+    \see IsoEx::ExtendedMarchingCubesT
+    \ingroup extractors
+*/
+template <class Mesh>
+void extended_marching_cubes(const Grid&                        _grid,
+			     const std::vector<Grid::CubeIdx>&  _cubes,
+			     Mesh&                              _mesh,
+			     double                             _feature_angle)
+{
+  ExtendedMarchingCubesT<Mesh> emc(_grid, _cubes, _mesh, _feature_angle);
+}
+
+
 //=============================================================================
 } // namespace IsoEx
 //=============================================================================
@@ -35,6 +35,7 @@
 
 #include <IsoEx/Extractors/MarchingCubesT.hh>
 #include <IsoEx/Extractors/MCTables.hh>
+#include <algorithm>
 #include <vector>
 
 //== NAMESPACES ===============================================================
@@ -50,9 +51,28 @@ MarchingCubesT(const Grid& _grid, Mesh& _mesh)
   : grid_(_grid),
     mesh_(_mesh)
 {
-  CubeIterator cube_it(grid_.begin()), cube_end(grid_.end());
-  for (; cube_it!=cube_end; ++cube_it)
-    process_cube(*cube_it);
+  const unsigned int n_cubes(grid_.n_cubes()), block(grid_.block_size());
+  for (CubeIdx first=0; first<n_cubes; first+=block)
+  {
+    if (grid_.is_empty_block(first))
+      continue;
+
+    const CubeIdx last = std::min(first+block, n_cubes);
+    for (CubeIdx idx=first; idx<last; ++idx)
+      process_cube(idx);
+  }
+}
+
+
+template <class Mesh>
+MarchingCubesT<Mesh>::
+MarchingCubesT(const Grid& _grid, const std::vector<CubeIdx>& _cubes,
+	       Mesh& _mesh)
+  : grid_(_grid),
+    mesh_(_mesh)
+{
+  for (unsigned int i=0; i<_cubes.size(); ++i)
+    process_cube(_cubes[i]);
 }
 
 
@@ -70,9 +90,13 @@ process_cube(CubeIdx _cidx)
   unsigned int       i;
 
 
+  // skip padding of e.g. bricked grids
+  if (!grid_.is_valid(_cidx))
+    return;
+
+
   // get point indices of corner vertices
-  for (i=0; i<8; ++i)
-    corner[i] = grid_.point_idx(_cidx, i);
+  grid_.point_indices(_cidx, corner);
 
 
   // determine cube type
@@ -118,8 +142,9 @@ typename MarchingCubesT<Mesh>::VertexHandle
 MarchingCubesT<Mesh>::
 add_vertex(PointIdx _p0, PointIdx _p1)
 {
-  // find vertex if it has been computed already
-  VertexHandle   vh = edge2vertex_.find(_p0, _p1);
+  // find vertex if it has been computed already, otherwise the new
+  // vertex is stored in the map's slot for this edge
+  VertexHandle&  vh = edge2vertex_(_p0, _p1);
   if (vh.is_valid())  return vh;
 
 
@@ -133,7 +158,6 @@ add_vertex(PointIdx _p0, PointIdx _p1)
   float t  = s0 / (s0+s1);
 
   vh = mesh_.add_vertex((1.0f-t)*p0 + t*p1);
-  edge2vertex_.insert(_p0, _p1, vh);
 
   return vh;
 }
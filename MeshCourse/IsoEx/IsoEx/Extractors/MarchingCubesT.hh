@@ -37,6 +37,7 @@
 #include <IsoEx/Extractors/Edge2VertexMapT.hh>
 #include <IsoEx/Grids/Grid.hh>
 #include <map>
+#include <vector>
 
 //== NAMESPACES ===============================================================
 
@@ -59,6 +60,10 @@ public:
    
   MarchingCubesT(const Grid& _grid, Mesh& _mesh);
 
+  /// Process the cubes \b _cubes only, e.g. the active cubes of a narrow band
+  MarchingCubesT(const Grid& _grid, const std::vector<Grid::CubeIdx>& _cubes,
+		 Mesh& _mesh);
+
   
 private:
 
@@ -97,6 +102,19 @@ void marching_cubes(const Grid& _grid, Mesh& _mesh)
 }
 
 
+/** Convenience wrapper for the Marching Cubes algorithm restricted to the
+    cubes \b _cubes, see IsoEx::sample_narrow_band().
+    \see IsoEx::MarchingCubesT
+    \ingroup extractors
+*/
+template <class Mesh>
+void marching_cubes(const Grid& _grid, const std::vector<Grid::CubeIdx>& _cubes,
+		    Mesh& _mesh)
+{
+  MarchingCubesT<Mesh> mc(_grid, _cubes, _mesh);
+}
+
+
 //=============================================================================
 } // namespace IsoEx
 //=============================================================================
@@ -0,0 +1,148 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------* 
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+//=============================================================================
+//
+//  CLASS OFFStreamWriter - IMPLEMENTATION
+//
+//=============================================================================
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Extractors/OFFStreamWriter.hh>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== IMPLEMENTATION ==========================================================
+
+
+// "OFF\n" precedes the counts, which have a fixed width
+static const long  COUNTS_OFFSET = 4;
+static const char  COUNTS_FORMAT[] = "%10d %10d 0\n";
+
+
+//-----------------------------------------------------------------------------
+
+
+OFFStreamWriter::
+OFFStreamWriter(const char* _filename)
+  : out_(fopen(_filename, "wb")),
+    faces_(0),
+    faces_name_(std::string(_filename) + ".faces"),
+    n_vertices_(0),
+    n_faces_(0)
+{
+  if (out_)
+  {
+    faces_ = fopen(faces_name_.c_str(), "w+b");
+    fprintf(out_, "OFF\n");
+    fprintf(out_, COUNTS_FORMAT, 0, 0);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+OFFStreamWriter::
+~OFFStreamWriter()
+{
+  close();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int
+OFFStreamWriter::
+add_vertex(const OpenMesh::Vec3f& _p)
+{
+  if (out_)
+    fprintf(out_, "%.9g %.9g %.9g\n", _p[0], _p[1], _p[2]);
+  return n_vertices_++;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void
+OFFStreamWriter::
+add_face(int _v0, int _v1, int _v2)
+{
+  int face[3] = { _v0, _v1, _v2 };
+  if (faces_)
+    fwrite(face, sizeof(int), 3, faces_);
+  ++n_faces_;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool
+OFFStreamWriter::
+close()
+{
+  if (!out_ && !faces_)
+    return false;
+
+  bool ok = is_open() && !ferror(out_) && !ferror(faces_);
+
+
+  // append the faces
+  if (ok)
+  {
+    int face[3];
+    rewind(faces_);
+    while (fread(face, sizeof(int), 3, faces_) == 3)
+      fprintf(out_, "3 %d %d %d\n", face[0], face[1], face[2]);
+    ok = !ferror(faces_);
+  }
+
+
+  // fill in the counts
+  if (ok)
+  {
+    ok = (fseek(out_, COUNTS_OFFSET, SEEK_SET) == 0 &&
+	  fprintf(out_, COUNTS_FORMAT, n_vertices_, n_faces_) > 0);
+  }
+
+  if (out_)    ok = (fclose(out_) == 0) && ok;
+  if (faces_)  fclose(faces_);
+  remove(faces_name_.c_str());
+
+  out_ = faces_ = 0;
+  return ok;
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
@@ -0,0 +1,98 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------* 
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+//=============================================================================
+//
+//  CLASS OFFStreamWriter
+//
+//=============================================================================
+
+#ifndef ISOEX_OFFSTREAMWRITER_HH
+#define ISOEX_OFFSTREAMWRITER_HH
+
+//== INCLUDES =================================================================
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <stdio.h>
+#include <string>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \class OFFStreamWriter OFFStreamWriter.hh <IsoEx/Extractors/OFFStreamWriter.hh>
+
+    Output of IsoEx::StreamingMarchingCubesT that writes an ASCII OFF
+    file without keeping the mesh in memory. The vertices are written
+    directly, the faces to the temporary file <tt>_filename.faces</tt>,
+    which close() appends to the vertices. The counts in the header are
+    written with a fixed width and filled in by close().
+
+    \ingroup extractors
+*/
+class OFFStreamWriter
+{
+public:
+
+  /// Opens \b _filename, check is_open() afterwards
+  OFFStreamWriter(const char* _filename);
+
+  /// Calls close() if that has not been done yet
+  ~OFFStreamWriter();
+
+  /// Could both files be opened?
+  bool is_open() const { return out_ != 0 && faces_ != 0; }
+
+  int add_vertex(const OpenMesh::Vec3f& _p);
+  void add_face(int _v0, int _v1, int _v2);
+
+  /// Completes the file, returns false if anything could not be written
+  bool close();
+
+  int n_vertices() const { return n_vertices_; }
+  int n_faces() const { return n_faces_; }
+
+
+private:
+
+  OFFStreamWriter(const OFFStreamWriter&);
+  OFFStreamWriter& operator=(const OFFStreamWriter&);
+
+  FILE*        out_;
+  FILE*        faces_;
+  std::string  faces_name_;
+  int          n_vertices_, n_faces_;
+};
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
+#endif // ISOEX_OFFSTREAMWRITER_HH defined
+//=============================================================================
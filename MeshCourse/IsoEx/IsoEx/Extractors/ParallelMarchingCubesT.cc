@@ -0,0 +1,273 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+//=============================================================================
+//
+//  CLASS ParallelMarchingCubesT - IMPLEMENTATION
+//
+//=============================================================================
+
+#define ISOEX_PARALLELMARCHINGCUBEST_C
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Extractors/ParallelMarchingCubesT.hh>
+#include <IsoEx/Extractors/MCTables.hh>
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== IMPLEMENTATION ==========================================================
+
+
+template <class Mesh>
+ParallelMarchingCubesT<Mesh>::
+ParallelMarchingCubesT(const RegularGrid& _grid, Mesh& _mesh)
+  : grid_(_grid),
+    mesh_(_mesh)
+{
+  if (grid_.n_cubes() == 0)
+    return;
+
+  const int n_layers = grid_.z_resolution() - 1;
+  int s;
+
+
+  // a few slabs per thread balance the load
+#ifdef _OPENMP
+  int n_slabs = std::min(n_layers, 4 * omp_get_max_threads());
+#else
+  int n_slabs = 1;
+#endif
+
+  std::vector<Slab> slabs(n_slabs);
+  for (s=0; s<n_slabs; ++s)
+  {
+    slabs[s].z0 = n_layers * s / n_slabs;
+    slabs[s].z1 = n_layers * (s+1) / n_slabs;
+  }
+
+
+  // extract the slabs independently
+#pragma omp parallel for schedule(dynamic, 1)
+  for (s=0; s<n_slabs; ++s)
+    process_slab(slabs[s]);
+
+
+  // the slab below owns the shared vertices, number the owned ones in
+  // slab order
+  std::vector<int> first(n_slabs+1, 0);
+  for (s=0; s<n_slabs; ++s)
+    first[s+1] = first[s] + slabs[s].n_owned;
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (s=0; s<n_slabs; ++s)
+  {
+    Slab& slab = slabs[s];
+    int next = first[s];
+    slab.global.resize(slab.points.size());
+    for (unsigned int v=0; v<slab.points.size(); ++v)
+      slab.global[v] = is_shared(slab, v) ? -1 : next++;
+  }
+
+  // weld the shared vertices to the owner's ones
+#pragma omp parallel for schedule(dynamic, 1)
+  for (s=1; s<n_slabs; ++s)
+  {
+    Slab& slab = slabs[s];
+    const Slab& below = slabs[s-1];
+    for (unsigned int v=0; v<slab.points.size(); ++v)
+    {
+      if (slab.global[v] < 0)
+      {
+        VertexHandle vh = below.edge2vertex.find(slab.edges[2*v], slab.edges[2*v+1]);
+        assert(vh.is_valid());
+        slab.global[v] = below.global[vh.idx()];
+      }
+    }
+  }
+
+
+  // build the mesh
+  size_t n_faces = 0;
+  for (s=0; s<n_slabs; ++s)
+    n_faces += slabs[s].triangles.size() / 3;
+
+  std::vector<typename Mesh::VertexHandle> vhandles(first[n_slabs]);
+  mesh_.reserve(mesh_.n_vertices() + first[n_slabs],
+                mesh_.n_edges() + first[n_slabs] + n_faces,
+                mesh_.n_faces() + n_faces);
+
+  for (s=0; s<n_slabs; ++s)
+  {
+    const Slab& slab = slabs[s];
+    for (unsigned int v=0; v<slab.points.size(); ++v)
+      if (slab.global[v] >= first[s])
+        vhandles[slab.global[v]] = mesh_.add_vertex(typename Mesh::Point(slab.points[v]));
+  }
+
+  for (s=0; s<n_slabs; ++s)
+  {
+    const Slab& slab = slabs[s];
+    for (unsigned int t=0; t<slab.triangles.size(); t+=3)
+      mesh_.add_face(vhandles[slab.global[slab.triangles[t  ]]],
+                     vhandles[slab.global[slab.triangles[t+1]]],
+                     vhandles[slab.global[slab.triangles[t+2]]]);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Mesh>
+void
+ParallelMarchingCubesT<Mesh>::
+process_slab(Slab& _slab) const
+{
+  const CubeIdx layer = (grid_.x_resolution()-1) * (grid_.y_resolution()-1);
+  const CubeIdx end   = _slab.z1 * layer;
+
+  for (CubeIdx idx = _slab.z0 * layer; idx < end; ++idx)
+    process_cube(idx, _slab);
+
+  _slab.n_owned = 0;
+  for (unsigned int v=0; v<_slab.points.size(); ++v)
+    if (!is_shared(_slab, v))
+      ++_slab.n_owned;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Mesh>
+bool
+ParallelMarchingCubesT<Mesh>::
+is_shared(const Slab& _slab, int _v) const
+{
+  const PointIdx plane = grid_.x_resolution() * grid_.y_resolution();
+  return (_slab.z0 > 0 &&
+          _slab.edges[2*_v]   / plane == _slab.z0 &&
+          _slab.edges[2*_v+1] / plane == _slab.z0);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Mesh>
+void
+ParallelMarchingCubesT<Mesh>::
+process_cube(CubeIdx _cidx, Slab& _slab) const
+{
+  PointIdx           corner[8];
+  int                samples[12];
+  unsigned char      cubetype(0);
+  unsigned int       i;
+
+
+  // get point indices of corner vertices
+  grid_.point_indices(_cidx, corner);
+
+
+  // determine cube type
+  for (i=0; i<8; ++i)
+    if (grid_.scalar_distance(corner[i]) > 0.0)
+      cubetype |= (1<<i);
+
+
+  // trivial reject ?
+  if (cubetype == 0 || cubetype == 255)
+    return;
+
+
+  // compute samples on cube's edges, same order as MarchingCubesT
+  if (edgeTable[cubetype]&1)    samples[0]  = add_vertex(corner[0], corner[1], _slab);
+  if (edgeTable[cubetype]&2)    samples[1]  = add_vertex(corner[1], corner[2], _slab);
+  if (edgeTable[cubetype]&4)    samples[2]  = add_vertex(corner[3], corner[2], _slab);
+  if (edgeTable[cubetype]&8)    samples[3]  = add_vertex(corner[0], corner[3], _slab);
+  if (edgeTable[cubetype]&16)   samples[4]  = add_vertex(corner[4], corner[5], _slab);
+  if (edgeTable[cubetype]&32)   samples[5]  = add_vertex(corner[5], corner[6], _slab);
+  if (edgeTable[cubetype]&64)   samples[6]  = add_vertex(corner[7], corner[6], _slab);
+  if (edgeTable[cubetype]&128)  samples[7]  = add_vertex(corner[4], corner[7], _slab);
+  if (edgeTable[cubetype]&256)  samples[8]  = add_vertex(corner[0], corner[4], _slab);
+  if (edgeTable[cubetype]&512)  samples[9]  = add_vertex(corner[1], corner[5], _slab);
+  if (edgeTable[cubetype]&1024) samples[10] = add_vertex(corner[2], corner[6], _slab);
+  if (edgeTable[cubetype]&2048) samples[11] = add_vertex(corner[3], corner[7], _slab);
+
+
+
+  // connect samples by triangles
+  for (i=0; triTable[cubetype][0][i] != -1; i+=3 )
+  {
+    _slab.triangles.push_back(samples[triTable[cubetype][0][i  ]]);
+    _slab.triangles.push_back(samples[triTable[cubetype][0][i+1]]);
+    _slab.triangles.push_back(samples[triTable[cubetype][0][i+2]]);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Mesh>
+int
+ParallelMarchingCubesT<Mesh>::
+add_vertex(PointIdx _p0, PointIdx _p1, Slab& _slab) const
+{
+  // find vertex if it has been computed already
+  VertexHandle&  vh = _slab.edge2vertex(_p0, _p1);
+  if (vh.is_valid())  return vh.idx();
+
+
+  // generate new vertex, interpolated exactly like MarchingCubesT does
+  const OpenMesh::Vec3f&  p0(grid_.point(_p0));
+  const OpenMesh::Vec3f&  p1(grid_.point(_p1));
+
+  float s0 = fabs(grid_.scalar_distance(_p0));
+  float s1 = fabs(grid_.scalar_distance(_p1));
+  float t  = s0 / (s0+s1);
+
+  vh = VertexHandle((int)_slab.points.size());
+  _slab.points.push_back((1.0f-t)*p0 + t*p1);
+  _slab.edges.push_back(_p0);
+  _slab.edges.push_back(_p1);
+
+  return vh.idx();
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
@@ -0,0 +1,131 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+//=============================================================================
+//
+//  CLASS ParallelMarchingCubesT
+//
+//=============================================================================
+
+#ifndef ISOEX_PARALLELMARCHINGCUBEST_HH
+#define ISOEX_PARALLELMARCHINGCUBEST_HH
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Extractors/Edge2VertexMapT.hh>
+#include <IsoEx/Grids/RegularGrid.hh>
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <OpenMesh/Core/Mesh/Handles.hh>
+#include <vector>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \class ParallelMarchingCubesT ParallelMarchingCubesT.hh <IsoEx/Extractors/ParallelMarchingCubesT.hh>
+
+    Marching Cubes on all cubes of a regular grid, parallelized by OpenMP.
+    The grid is split into slabs of whole z-layers of cubes. Every slab
+    is extracted independently into its own vertex and triangle buffers,
+    then the vertices on the bottom plane of each slab are welded to the
+    ones of the slab below, which owns them. Finally the mesh is built
+    from the buffers in slab order.
+
+    A vertex is owned by the slab whose cubes create it first in the
+    serial cube order, and every slab creates its vertices in that order,
+    so the resulting mesh is identical to the one of IsoEx::MarchingCubesT
+    (including vertex and face order), independent of the number of
+    threads. The grid's scalar_distance() has to be thread-safe.
+
+    Use it through the convenience function
+    <b> IsoEx::parallel_marching_cubes() </b>.
+    \ingroup extractors
+*/
+template <class Mesh>
+class ParallelMarchingCubesT
+{
+public:
+
+  ParallelMarchingCubesT(const RegularGrid& _grid, Mesh& _mesh);
+
+
+private:
+
+  typedef Grid::PointIdx           PointIdx;
+  typedef Grid::CubeIdx            CubeIdx;
+  typedef OpenMesh::VertexHandle   VertexHandle;
+
+  // vertices and triangles of a slab of cube layers [z0,z1)
+  struct Slab
+  {
+    unsigned int                  z0, z1;
+    std::vector<OpenMesh::Vec3f>  points;
+    std::vector<PointIdx>         edges;       // 2 end points per vertex
+    std::vector<int>              triangles;   // 3 local vertices per face
+    std::vector<int>              global;      // local -> mesh vertex
+    int                           n_owned;
+    Edge2VertexMapT<PointIdx, VertexHandle>  edge2vertex;
+  };
+
+  void process_slab(Slab& _slab) const;
+  void process_cube(CubeIdx _idx, Slab& _slab) const;
+  int  add_vertex(PointIdx _p0, PointIdx _p1, Slab& _slab) const;
+
+  // is the vertex on the slab's bottom plane, i.e. shared with the slab below
+  bool is_shared(const Slab& _slab, int _v) const;
+
+
+  const RegularGrid&  grid_;
+  Mesh&               mesh_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+/** Convenience wrapper for the parallel Marching Cubes algorithm.
+    \see IsoEx::ParallelMarchingCubesT
+    \ingroup extractors
+*/
+template <class Mesh>
+void parallel_marching_cubes(const RegularGrid& _grid, Mesh& _mesh)
+{
+  ParallelMarchingCubesT<Mesh> mc(_grid, _mesh);
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
+#if defined(INCLUDE_TEMPLATES) && !defined(ISOEX_PARALLELMARCHINGCUBEST_C)
+#define ISOEX_PARALLELMARCHINGCUBEST_TEMPLATES
+#include "ParallelMarchingCubesT.cc"
+#endif
+//=============================================================================
+#endif // ISOEX_PARALLELMARCHINGCUBEST_HH defined
+//=============================================================================
@@ -0,0 +1,244 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------* 
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+//=============================================================================
+//
+//  CLASS StreamingMarchingCubesT - IMPLEMENTATION
+//
+//=============================================================================
+
+#define ISOEX_STREAMINGMARCHINGCUBEST_C
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Extractors/StreamingMarchingCubesT.hh>
+#include <IsoEx/Extractors/MCTables.hh>
+#include <algorithm>
+#include <math.h>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== IMPLEMENTATION ==========================================================
+
+
+template <class Func, class Output>
+StreamingMarchingCubesT<Func, Output>::
+StreamingMarchingCubesT(const Func&             _func,
+			const OpenMesh::Vec3f&  _origin,
+			const OpenMesh::Vec3f&  _x_axis,
+			const OpenMesh::Vec3f&  _y_axis,
+			const OpenMesh::Vec3f&  _z_axis,
+			unsigned int            _x_res,
+			unsigned int            _y_res,
+			unsigned int            _z_res,
+			Output&                 _output)
+  : func_(_func),
+    output_(_output),
+    origin_(_origin),
+    x_res_(_x_res),
+    y_res_(_y_res),
+    z_res_(_z_res)
+{
+  if (x_res_ < 2 || y_res_ < 2 || z_res_ < 2)
+    return;
+
+  dx_ = _x_axis / (float)(x_res_-1);
+  dy_ = _y_axis / (float)(y_res_-1);
+  dz_ = _z_axis / (float)(z_res_-1);
+
+  const unsigned int nx(x_res_), ny(y_res_);
+  below_.resize(nx*ny);
+  above_.resize(nx*ny);
+  for (int i=0; i<2; ++i)
+  {
+    x_edges_[i].assign((nx-1)*ny, -1);
+    y_edges_[i].assign(nx*(ny-1), -1);
+  }
+  z_edges_.assign(nx*ny, -1);
+
+
+  // sweep the layers of cubes bottom up, the slice above one layer is
+  // the slice below the next
+  sample_slice(0, below_);
+  for (unsigned int z=0; z+1<z_res_; ++z)
+  {
+    sample_slice(z+1, above_);
+    process_layer(z);
+
+    below_.swap(above_);
+    x_edges_[0].swap(x_edges_[1]);
+    y_edges_[0].swap(y_edges_[1]);
+    std::fill(x_edges_[1].begin(), x_edges_[1].end(), -1);
+    std::fill(y_edges_[1].begin(), y_edges_[1].end(), -1);
+    std::fill(z_edges_.begin(), z_edges_.end(), -1);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Output>
+void
+StreamingMarchingCubesT<Func, Output>::
+sample_slice(unsigned int _z, std::vector<float>& _values) const
+{
+  const int nx(x_res_), ny(y_res_);
+
+#pragma omp parallel
+  {
+    std::vector<float> x(nx), y(nx), z(nx);
+
+#pragma omp for schedule(dynamic, 1)
+    for (int row=0; row<ny; ++row)
+    {
+      for (int i=0; i<nx; ++i)
+      {
+	OpenMesh::Vec3f p = point(i, row, _z);
+	x[i] = p[0];  y[i] = p[1];  z[i] = p[2];
+      }
+      func_(&x[0], &y[0], &z[0], nx, &_values[row*nx]);
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Output>
+void
+StreamingMarchingCubesT<Func, Output>::
+process_layer(unsigned int _z)
+{
+  const unsigned int  nx(x_res_), ny(y_res_), z0(_z), z1(_z+1);
+  const float*        below(&below_[0]);
+  const float*        above(&above_[0]);
+  int*                xe0(&x_edges_[0][0]);
+  int*                xe1(&x_edges_[1][0]);
+  int*                ye0(&y_edges_[0][0]);
+  int*                ye1(&y_edges_[1][0]);
+  int*                ze(&z_edges_[0]);
+  float               s[8];
+  int                 samples[12];
+  unsigned int        x, y, i;
+
+
+  for (y=0; y+1<ny; ++y)
+  {
+    for (x=0; x+1<nx; ++x)
+    {
+      // point in the slices and x-edge of corner 0
+      const unsigned int p(x + y*nx), e(x + y*(nx-1));
+
+
+      // corner values, numbered like RegularGrid
+      s[0] = below[p];  s[1] = below[p+1];  s[2] = below[p+1+nx];  s[3] = below[p+nx];
+      s[4] = above[p];  s[5] = above[p+1];  s[6] = above[p+1+nx];  s[7] = above[p+nx];
+
+
+      // determine cube type
+      unsigned char cubetype(0);
+      for (i=0; i<8; ++i)
+	if (s[i] > 0.0)
+	  cubetype |= (1<<i);
+
+
+      // trivial reject ?
+      if (cubetype == 0 || cubetype == 255)
+	continue;
+
+
+      // compute samples on cube's edges, same order as MarchingCubesT
+      if (edgeTable[cubetype]&1)
+	samples[0]  = add_vertex(xe0[e],      x,   y,   z0, s[0],  x+1, y,   z0, s[1]);
+      if (edgeTable[cubetype]&2)
+	samples[1]  = add_vertex(ye0[p+1],    x+1, y,   z0, s[1],  x+1, y+1, z0, s[2]);
+      if (edgeTable[cubetype]&4)
+	samples[2]  = add_vertex(xe0[e+nx-1], x,   y+1, z0, s[3],  x+1, y+1, z0, s[2]);
+      if (edgeTable[cubetype]&8)
+	samples[3]  = add_vertex(ye0[p],      x,   y,   z0, s[0],  x,   y+1, z0, s[3]);
+      if (edgeTable[cubetype]&16)
+	samples[4]  = add_vertex(xe1[e],      x,   y,   z1, s[4],  x+1, y,   z1, s[5]);
+      if (edgeTable[cubetype]&32)
+	samples[5]  = add_vertex(ye1[p+1],    x+1, y,   z1, s[5],  x+1, y+1, z1, s[6]);
+      if (edgeTable[cubetype]&64)
+	samples[6]  = add_vertex(xe1[e+nx-1], x,   y+1, z1, s[7],  x+1, y+1, z1, s[6]);
+      if (edgeTable[cubetype]&128)
+	samples[7]  = add_vertex(ye1[p],      x,   y,   z1, s[4],  x,   y+1, z1, s[7]);
+      if (edgeTable[cubetype]&256)
+	samples[8]  = add_vertex(ze[p],       x,   y,   z0, s[0],  x,   y,   z1, s[4]);
+      if (edgeTable[cubetype]&512)
+	samples[9]  = add_vertex(ze[p+1],     x+1, y,   z0, s[1],  x+1, y,   z1, s[5]);
+      if (edgeTable[cubetype]&1024)
+	samples[10] = add_vertex(ze[p+1+nx],  x+1, y+1, z0, s[2],  x+1, y+1, z1, s[6]);
+      if (edgeTable[cubetype]&2048)
+	samples[11] = add_vertex(ze[p+nx],    x,   y+1, z0, s[3],  x,   y+1, z1, s[7]);
+
+
+      // connect samples by triangles
+      for (i=0; triTable[cubetype][0][i] != -1; i+=3 )
+	output_.add_face(samples[triTable[cubetype][0][i  ]],
+			 samples[triTable[cubetype][0][i+1]],
+			 samples[triTable[cubetype][0][i+2]]);
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Output>
+int
+StreamingMarchingCubesT<Func, Output>::
+add_vertex(int& _slot,
+	   unsigned int _x0, unsigned int _y0, unsigned int _z0, float _s0,
+	   unsigned int _x1, unsigned int _y1, unsigned int _z1, float _s1)
+{
+  // vertex has been computed already by a neighboring cube
+  if (_slot >= 0)  return _slot;
+
+
+  // generate new vertex, interpolated exactly like MarchingCubesT does
+  const OpenMesh::Vec3f  p0(point(_x0, _y0, _z0));
+  const OpenMesh::Vec3f  p1(point(_x1, _y1, _z1));
+
+  float s0 = fabs(_s0);
+  float s1 = fabs(_s1);
+  float t  = s0 / (s0+s1);
+
+  _slot = output_.add_vertex((1.0f-t)*p0 + t*p1);
+
+  return _slot;
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
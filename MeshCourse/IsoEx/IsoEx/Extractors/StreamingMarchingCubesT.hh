@@ -0,0 +1,190 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------* 
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+//=============================================================================
+//
+//  CLASS StreamingMarchingCubesT
+//
+//=============================================================================
+
+#ifndef ISOEX_STREAMINGMARCHINGCUBEST_HH
+#define ISOEX_STREAMINGMARCHINGCUBEST_HH
+
+//== INCLUDES =================================================================
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <OpenMesh/Core/Mesh/Handles.hh>
+#include <vector>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \class StreamingMarchingCubesT StreamingMarchingCubesT.hh <IsoEx/Extractors/StreamingMarchingCubesT.hh>
+
+    Marching Cubes on a regular grid that is never stored. The function
+    is sampled one z-slice at a time, only the two slices of the current
+    layer of cubes are kept, and the vertices on the edges of that layer
+    are looked up in per-edge arrays instead of a map. The memory is
+    therefore O(x_res*y_res), independent of z_res, and the resolution is
+    not limited to the 1024 of RegularGrid.
+
+    \b _func is sampled like by IsoEx::sample_grid(), i.e. it has to
+    provide a thread-safe batch evaluation
+    <tt>operator()(const float* _x, const float* _y, const float* _z,
+    int _n, float* _values) const</tt>; the rows of a slice are sampled
+    in parallel. The vertices and triangles are emitted to \b _output,
+    which has to provide <tt>int add_vertex(const OpenMesh::Vec3f&)</tt>,
+    returning consecutive indices starting at 0, and
+    <tt>void add_face(int, int, int)</tt>. See IsoEx::MeshOutputT and
+    IsoEx::OFFStreamWriter.
+
+    The cubes are processed in the order of IsoEx::MarchingCubesT, so the
+    output is identical to marching_cubes() on a IsoEx::ScalarGridT that
+    has been sampled with the same function, including the vertex and
+    face order.
+
+    Use it through the convenience function
+    <b> IsoEx::streaming_marching_cubes() </b>.
+    \ingroup extractors
+*/
+template <class Func, class Output>
+class StreamingMarchingCubesT
+{
+public:
+
+  StreamingMarchingCubesT(const Func&             _func,
+			  const OpenMesh::Vec3f&  _origin,
+			  const OpenMesh::Vec3f&  _x_axis,
+			  const OpenMesh::Vec3f&  _y_axis,
+			  const OpenMesh::Vec3f&  _z_axis,
+			  unsigned int            _x_res,
+			  unsigned int            _y_res,
+			  unsigned int            _z_res,
+			  Output&                 _output);
+
+
+private:
+
+  // grid point at x,y,z, computed like RegularGrid::point()
+  OpenMesh::Vec3f point(unsigned int _x, unsigned int _y, unsigned int _z) const {
+    return origin_ + dx_*static_cast<float>(_x)
+      + dy_*static_cast<float>(_y)
+      + dz_*static_cast<float>(_z);
+  }
+
+  void sample_slice(unsigned int _z, std::vector<float>& _values) const;
+  void process_layer(unsigned int _z);
+
+  // vertex on the edge from point (x0,y0,z0) to (x1,y1,z1), stored in
+  // _slot and generated only if _slot is still empty
+  int add_vertex(int& _slot,
+		 unsigned int _x0, unsigned int _y0, unsigned int _z0, float _s0,
+		 unsigned int _x1, unsigned int _y1, unsigned int _z1, float _s1);
+
+
+  const Func&       func_;
+  Output&           output_;
+
+  OpenMesh::Vec3f   origin_, dx_, dy_, dz_;
+  unsigned int      x_res_, y_res_, z_res_;
+
+  // values of the slices below and above the current layer of cubes
+  std::vector<float>  below_, above_;
+
+  // vertex index on each x- and y-edge of the slices below [0] and
+  // above [1], and on each z-edge of the layer, -1 if none
+  std::vector<int>    x_edges_[2], y_edges_[2], z_edges_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+/** Output of StreamingMarchingCubesT that builds an OpenMesh mesh.
+    \ingroup extractors
+*/
+template <class Mesh>
+class MeshOutputT
+{
+public:
+
+  MeshOutputT(Mesh& _mesh) : mesh_(_mesh), offset_(_mesh.n_vertices()) {}
+
+  int add_vertex(const OpenMesh::Vec3f& _p) {
+    return mesh_.add_vertex(typename Mesh::Point(_p)).idx() - offset_;
+  }
+
+  void add_face(int _v0, int _v1, int _v2) {
+    mesh_.add_face(typename Mesh::VertexHandle(offset_ + _v0),
+		   typename Mesh::VertexHandle(offset_ + _v1),
+		   typename Mesh::VertexHandle(offset_ + _v2));
+  }
+
+private:
+
+  Mesh&  mesh_;
+  int    offset_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+/** Convenience wrapper for the streaming Marching Cubes algorithm.
+    \see IsoEx::StreamingMarchingCubesT
+    \ingroup extractors
+*/
+template <class Func, class Output>
+void streaming_marching_cubes(const Func&             _func,
+			      const OpenMesh::Vec3f&  _origin,
+			      const OpenMesh::Vec3f&  _x_axis,
+			      const OpenMesh::Vec3f&  _y_axis,
+			      const OpenMesh::Vec3f&  _z_axis,
+			      unsigned int            _x_res,
+			      unsigned int            _y_res,
+			      unsigned int            _z_res,
+			      Output&                 _output)
+{
+  StreamingMarchingCubesT<Func, Output> mc(_func, _origin,
+					   _x_axis, _y_axis, _z_axis,
+					   _x_res, _y_res, _z_res, _output);
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
+#if defined(INCLUDE_TEMPLATES) && !defined(ISOEX_STREAMINGMARCHINGCUBEST_C)
+#define ISOEX_STREAMINGMARCHINGCUBEST_TEMPLATES
+#include "StreamingMarchingCubesT.cc"
+#endif
+//=============================================================================
+#endif // ISOEX_STREAMINGMARCHINGCUBEST_HH defined
+//=============================================================================
@@ -0,0 +1,312 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------* 
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+//=============================================================================
+//
+//  CLASS TriangleBuffer
+//
+//=============================================================================
+
+#ifndef ISOEX_TRIANGLEBUFFER_HH
+#define ISOEX_TRIANGLEBUFFER_HH
+
+//== INCLUDES =================================================================
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <OpenMesh/Core/Mesh/Handles.hh>
+#include <vector>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \class TriangleBuffer TriangleBuffer.hh <IsoEx/Extractors/TriangleBuffer.hh>
+
+    An indexed triangle list in flat arrays: 3 floats per vertex and 3
+    vertex indices per triangle. It provides the part of the mesh
+    interface the extractors use, so it can replace the mesh of
+    IsoEx::MarchingCubesT and IsoEx::ParallelMarchingCubesT (and via
+    IsoEx::MeshOutputT of IsoEx::StreamingMarchingCubesT), which then
+    skip the per-face connectivity update of OpenMesh's add_face().
+
+    to_mesh() converts the buffer to an OpenMesh mesh afterwards and
+    builds the halfedge connectivity in a few linear passes.
+*/
+class TriangleBuffer
+{
+public:
+
+  typedef OpenMesh::Vec3f         Point;
+  typedef OpenMesh::VertexHandle  VertexHandle;
+  typedef OpenMesh::FaceHandle    FaceHandle;
+
+  /// x, y, z of each vertex
+  std::vector<float>         points;
+
+  /// the 3 vertex indices of each triangle
+  std::vector<unsigned int>  indices;
+
+
+  //--------------------------------------------------------- mesh interface
+
+  unsigned int n_vertices() const { return (unsigned int)points.size() / 3; }
+  unsigned int n_faces() const { return (unsigned int)indices.size() / 3; }
+
+  /// There are no edges, reserve() ignores their number
+  unsigned int n_edges() const { return 0; }
+
+  void reserve(unsigned int _n_vertices, unsigned int /*_n_edges*/,
+	       unsigned int _n_faces) {
+    points.reserve(3*_n_vertices);
+    indices.reserve(3*_n_faces);
+  }
+
+  void clear() { points.clear(); indices.clear(); }
+
+  VertexHandle add_vertex(const Point& _p) {
+    points.push_back(_p[0]);
+    points.push_back(_p[1]);
+    points.push_back(_p[2]);
+    return VertexHandle(n_vertices()-1);
+  }
+
+  FaceHandle add_face(VertexHandle _v0, VertexHandle _v1, VertexHandle _v2) {
+    indices.push_back(_v0.idx());
+    indices.push_back(_v1.idx());
+    indices.push_back(_v2.idx());
+    return FaceHandle(n_faces()-1);
+  }
+
+
+  //------------------------------------------------------------- conversion
+
+  /** Replace the contents of \b _mesh by the buffer's vertices and
+      triangles, in the same order. Each halfedge of a triangle is
+      paired with its opposite found in the outgoing halfedges of its
+      target vertex, then all elements are allocated at once, their
+      handles set and the boundary halfedges linked.
+      If an edge has more than two triangles, inconsistently oriented
+      ones or a vertex has several boundary fans, the mesh is built by
+      add_face() instead, which drops the triangles OpenMesh cannot
+      represent. */
+  template <class Mesh>
+  void to_mesh(Mesh& _mesh) const;
+
+
+private:
+
+  // build the connectivity directly, false if it is not manifold
+  template <class Mesh>
+  bool build_connectivity(Mesh& _mesh) const;
+
+  // corner _c is the halfedge from vertex indices[_c] to the one of the
+  // next corner of its triangle
+  static unsigned int next_corner(unsigned int _c) {
+    return (_c % 3 == 2) ? _c-2 : _c+1;
+  }
+};
+
+
+//=============================================================================
+
+
+template <class Mesh>
+void
+TriangleBuffer::
+to_mesh(Mesh& _mesh) const
+{
+  _mesh.clear();
+  if (build_connectivity(_mesh))
+    return;
+
+
+  // fall back to the incremental construction
+  const unsigned int nv(n_vertices()), nf(n_faces());
+  unsigned int v, f;
+
+  _mesh.clear();
+  _mesh.reserve(nv, nv + nf, nf);
+  for (v=0; v<nv; ++v)
+    _mesh.add_vertex(typename Mesh::Point(points[3*v], points[3*v+1], points[3*v+2]));
+  for (f=0; f<nf; ++f)
+    _mesh.add_face(typename Mesh::VertexHandle(indices[3*f  ]),
+		   typename Mesh::VertexHandle(indices[3*f+1]),
+		   typename Mesh::VertexHandle(indices[3*f+2]));
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Mesh>
+bool
+TriangleBuffer::
+build_connectivity(Mesh& _mesh) const
+{
+  typedef typename Mesh::VertexHandle    VH;
+  typedef typename Mesh::HalfedgeHandle  HH;
+  typedef typename Mesh::FaceHandle      FH;
+
+  const unsigned int nv(n_vertices()), nc(3*n_faces());
+  unsigned int c, i, v;
+
+
+  // outgoing corners of each vertex, CSR layout
+  std::vector<unsigned int> first(nv+1, 0), out(nc);
+  for (c=0; c<nc; ++c)
+  {
+    if (indices[c] >= nv || indices[c] == indices[next_corner(c)])
+      return false;
+    ++first[indices[c]+1];
+  }
+  for (v=0; v<nv; ++v)
+    first[v+1] += first[v];
+  {
+    std::vector<unsigned int> fill(first.begin(), first.end()-1);
+    for (c=0; c<nc; ++c)
+      out[fill[indices[c]]++] = c;
+  }
+
+
+  // pair the corners: the corner u->w creates edge e, its halfedge 2e,
+  // the opposite corner w->u gets halfedge 2e+1
+  std::vector<int> halfedge(nc, -1);
+  int n_edges(0);
+  for (c=0; c<nc; ++c)
+  {
+    if (halfedge[c] >= 0)
+      continue;
+
+    const unsigned int u(indices[c]), w(indices[next_corner(c)]);
+    int opposite(-1);
+
+    for (i=first[u]; i<first[u+1]; ++i)
+      if (out[i] != c && indices[next_corner(out[i])] == w)
+	return false;
+
+    for (i=first[w]; i<first[w+1]; ++i)
+    {
+      if (indices[next_corner(out[i])] == u)
+      {
+	if (opposite >= 0)
+	  return false;
+	opposite = out[i];
+      }
+    }
+
+    halfedge[c] = 2*n_edges;
+    if (opposite >= 0)
+      halfedge[opposite] = 2*n_edges+1;
+    ++n_edges;
+  }
+
+
+  // allocate all elements at once, then fill in the handles
+  _mesh.resize(nv, n_edges, nc/3);
+
+  for (v=0; v<nv; ++v)
+    _mesh.set_point(VH(v), typename Mesh::Point(points[3*v], points[3*v+1], points[3*v+2]));
+
+  for (c=0; c<nc; ++c)
+  {
+    if (halfedge[c] % 2 == 0)
+    {
+      _mesh.set_vertex_handle(HH(halfedge[c]),   VH(indices[next_corner(c)]));
+      _mesh.set_vertex_handle(HH(halfedge[c]+1), VH(indices[c]));
+    }
+  }
+
+  for (c=0; c<nc; c+=3)
+  {
+    FH fh(c/3);
+    _mesh.set_halfedge_handle(fh, HH(halfedge[c+2]));  // as add_face() does
+    for (i=c; i<c+3; ++i)
+    {
+      _mesh.set_face_handle(HH(halfedge[i]), fh);
+      _mesh.set_next_halfedge_handle(HH(halfedge[i]), HH(halfedge[next_corner(i)]));
+      _mesh.set_halfedge_handle(VH(indices[i]), HH(halfedge[i]));
+    }
+  }
+
+
+  // a boundary vertex has a single outgoing boundary halfedge, which is
+  // its outgoing halfedge, and the boundary halfedge into it is followed
+  // by that one
+  const int nh(_mesh.n_halfedges());
+  int h;
+  for (h=0; h<nh; ++h)
+  {
+    HH hh(h);
+    if (!_mesh.is_boundary(hh))
+      continue;
+
+    VH vh = _mesh.from_vertex_handle(hh);
+    if (_mesh.is_boundary(_mesh.halfedge_handle(vh)))
+      return false;
+    _mesh.set_halfedge_handle(vh, hh);
+  }
+  for (h=0; h<nh; ++h)
+  {
+    HH hh(h);
+    if (_mesh.is_boundary(hh))
+      _mesh.set_next_halfedge_handle(hh, _mesh.halfedge_handle(_mesh.to_vertex_handle(hh)));
+  }
+
+
+  // all outgoing halfedges of a vertex have to be in a single fan: one
+  // per corner, plus one boundary halfedge
+  for (v=0; v<nv; ++v)
+  {
+    HH start = _mesh.halfedge_handle(VH(v)), hh = start;
+    if (!start.is_valid())
+      continue;
+
+    unsigned int n(0), expected(first[v+1] - first[v]);
+    if (_mesh.is_boundary(start))
+      ++expected;
+    do
+    {
+      hh = _mesh.next_halfedge_handle(_mesh.opposite_halfedge_handle(hh));
+      ++n;
+    }
+    while (hh != start && n <= expected);
+
+    if (n != expected)
+      return false;
+  }
+
+  return true;
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
+#endif // ISOEX_TRIANGLEBUFFER_HH defined
+//=============================================================================
@@ -0,0 +1,170 @@
+//=============================================================================
+//
+//  CLASS BrickedScalarGridT - IMPLEMENTATION
+//
+//=============================================================================
+
+#define ISOEX_BRICKEDSCALARGRIDT_C
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Grids/BrickedScalarGridT.hh>
+#include <algorithm>
+#include <assert.h>
+
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== IMPLEMENTATION ==========================================================
+
+
+template <class Scalar>
+void
+BrickedScalarGridT<Scalar>::
+initialize(const OpenMesh::Vec3f&  _origin,
+	   const OpenMesh::Vec3f&  _x_axis,
+	   const OpenMesh::Vec3f&  _y_axis,
+	   const OpenMesh::Vec3f&  _z_axis,
+	   unsigned int            _x_res,
+	   unsigned int            _y_res,
+	   unsigned int            _z_res)
+{
+  assert(_x_res >= 2 && _y_res >= 2 && _z_res >= 2);
+  assert(_x_res <= 1024 && _y_res <= 1024 && _z_res <= 1024);
+
+  origin_ = _origin;
+  x_axis_ = _x_axis;
+  y_axis_ = _y_axis;
+  z_axis_ = _z_axis;
+  x_res_  = _x_res;
+  y_res_  = _y_res;
+  z_res_  = _z_res;
+
+  dx_ = x_axis_ / (float)(x_res_-1);
+  dy_ = y_axis_ / (float)(y_res_-1);
+  dz_ = z_axis_ / (float)(z_res_-1);
+
+  bx_ = (x_res_ + BRICK-1) / BRICK;
+  by_ = (y_res_ + BRICK-1) / BRICK;
+  bz_ = (z_res_ + BRICK-1) / BRICK;
+  const unsigned int n_bricks = bx_ * by_ * bz_;
+
+
+  // sort the bricks by their Morton code, i.e. the interleaved bits of
+  // their coordinates
+  std::vector< std::pair<unsigned long long, unsigned int> > order(n_bricks);
+  unsigned int b(0), x, y, z;
+  for (z=0; z<bz_; ++z)
+    for (y=0; y<by_; ++y)
+      for (x=0; x<bx_; ++x, ++b)
+      {
+	unsigned long long code(0);
+	for (unsigned int bit=0; bit<10; ++bit)
+	  code |= (((unsigned long long)(x >> bit) & 1) << (3*bit))
+	    |     (((unsigned long long)(y >> bit) & 1) << (3*bit+1))
+	    |     (((unsigned long long)(z >> bit) & 1) << (3*bit+2));
+	order[b] = std::make_pair(code, b);
+      }
+  std::sort(order.begin(), order.end());
+
+  brick_index_.resize(n_bricks);
+  brick_coords_.resize(n_bricks);
+  for (unsigned int rank=0; rank<n_bricks; ++rank)
+  {
+    b = order[rank].second;
+    brick_index_[b] = rank;
+    brick_coords_[rank] = (b % bx_) | ((b / bx_ % by_) << 10) | ((b / (bx_*by_)) << 20);
+  }
+
+  values_ = Values(n_bricks * BRICK_SIZE, 0);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Scalar>
+void
+BrickedScalarGridT<Scalar>::
+point_indices(CubeIdx _idx, PointIdx _corners[8]) const
+{
+  // cubes inside the brick: constant offsets of the corners 0..7, same
+  // numbering as RegularGrid
+  if ((_idx & 7) != 7 && ((_idx >> 3) & 7) != 7 && ((_idx >> 6) & 7) != 7)
+  {
+    _corners[0] = _idx;
+    _corners[1] = _idx + 1;
+    _corners[2] = _idx + 1 + BRICK;
+    _corners[3] = _idx +     BRICK;
+    _corners[4] = _idx +             BRICK*BRICK;
+    _corners[5] = _idx + 1 +         BRICK*BRICK;
+    _corners[6] = _idx + 1 + BRICK + BRICK*BRICK;
+    _corners[7] = _idx +     BRICK + BRICK*BRICK;
+    return;
+  }
+
+  // cubes on the upper faces of the brick reach into its neighbors
+  unsigned int x, y, z;
+  coordinates(_idx, x, y, z);
+  _corners[0] = _idx;
+  _corners[1] = point_idx(x+1, y,   z  );
+  _corners[2] = point_idx(x+1, y+1, z  );
+  _corners[3] = point_idx(x,   y+1, z  );
+  _corners[4] = point_idx(x,   y,   z+1);
+  _corners[5] = point_idx(x+1, y,   z+1);
+  _corners[6] = point_idx(x+1, y+1, z+1);
+  _corners[7] = point_idx(x,   y+1, z+1);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Scalar>
+bool
+BrickedScalarGridT<Scalar>::
+is_empty_block(CubeIdx _first) const
+{
+  // the brick's cubes use its 8^3 points plus the first layer of points
+  // of the upper neighbors
+  unsigned int x0, y0, z0;
+  coordinates(_first, x0, y0, z0);
+  const unsigned int x1 = std::min(x0+BRICK+1, x_res_);
+  const unsigned int y1 = std::min(y0+BRICK+1, y_res_);
+  const unsigned int z1 = std::min(z0+BRICK+1, z_res_);
+
+  bool all_inside(true), all_outside(true);
+  unsigned int x, y, z;
+
+  for (z=z0; z<z1; ++z)
+    for (y=y0; y<y1; ++y)
+      for (x=x0; x<x1; ++x)
+      {
+	const Scalar v = values_[point_idx(x, y, z)];
+	all_inside  = all_inside  && v < 0.0;
+	all_outside = all_outside && v > 0.0;
+	if (!all_inside && !all_outside)
+	  return false;
+      }
+
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Scalar>
+void
+BrickedScalarGridT<Scalar>::
+sample(const Implicit& _implicit)
+{
+  sample_function(ScalarDistanceFunc(_implicit));
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
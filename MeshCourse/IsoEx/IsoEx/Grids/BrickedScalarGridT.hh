@@ -0,0 +1,237 @@
+//=============================================================================
+//
+//  CLASS BrickedScalarGridT
+//
+//=============================================================================
+
+
+#ifndef ISOEX_BRICKEDSCALARGRIDT_HH
+#define ISOEX_BRICKEDSCALARGRIDT_HH
+
+
+//== INCLUDES =================================================================
+
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <IsoEx/Grids/Grid.hh>
+#include <IsoEx/Grids/GridSampler.hh>
+#include <IsoEx/Implicits/Implicit.hh>
+#include <vector>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \class BrickedScalarGridT BrickedScalarGridT.hh <IsoEx/Grids/BrickedScalarGridT.hh>
+
+    A regular grid of scalar values like ScalarGridT, but stored in
+    bricks of 8x8x8 points. Within a brick the values are x-fastest, the
+    bricks themselves are laid out in Morton (z-order) order, so the 8
+    corners of a cube and the neighboring cubes share few cache lines
+    even along y and z.
+
+    A PointIdx is the storage position of a value, a CubeIdx the
+    position of the cube's corner 0. The corner positions of the cubes
+    that do not touch the upper faces of their brick are the cube's
+    position plus 8 constant offsets, only the others need to look up
+    the neighboring bricks. Iterating from begin() to end() therefore
+    visits the cubes brick by brick, and MarchingCubesT and
+    ExtendedMarchingCubesT skip the bricks the surface does not pass
+    through, see is_empty_block(). Positions in the padding of the
+    bricks at the upper grid boundary are not cubes, see is_valid().
+
+    Only the serial MarchingCubesT and ExtendedMarchingCubesT extract
+    from this grid, ParallelMarchingCubesT takes a RegularGrid. The
+    reconstruct tool uses it with --bricked, which cannot be combined
+    with narrow band sampling or the grid cache.
+
+    Resolutions up to 1024 per axis are supported.
+
+    \ingroup grids
+*/
+template <typename Scalar>
+class BrickedScalarGridT : public Grid
+{
+public:
+
+  typedef std::vector<Scalar>  Values;
+
+  /// edge length of the bricks in points
+  enum { BRICK = 8, BRICK_SIZE = BRICK*BRICK*BRICK };
+
+  /// Constructor, see RegularGrid
+  BrickedScalarGridT(const OpenMesh::Vec3f&  _origin = OpenMesh::Vec3f(0,0,0),
+		     const OpenMesh::Vec3f&  _x_axis = OpenMesh::Vec3f(1,0,0),
+		     const OpenMesh::Vec3f&  _y_axis = OpenMesh::Vec3f(0,1,0),
+		     const OpenMesh::Vec3f&  _z_axis = OpenMesh::Vec3f(0,0,1),
+		     unsigned int            _x_res  = 10,
+		     unsigned int            _y_res  = 10,
+		     unsigned int            _z_res  = 10)
+  { initialize(_origin, _x_axis, _y_axis, _z_axis, _x_res, _y_res, _z_res); }
+
+  /// Destructor
+  virtual ~BrickedScalarGridT() {}
+
+  void initialize(const OpenMesh::Vec3f&  _origin,
+		  const OpenMesh::Vec3f&  _x_axis,
+		  const OpenMesh::Vec3f&  _y_axis,
+		  const OpenMesh::Vec3f&  _z_axis,
+		  unsigned int            _x_res,
+		  unsigned int            _y_res,
+		  unsigned int            _z_res);
+
+
+  //------------------------------------------------------- mandatory interface
+
+  /// Number of storage positions of cubes, including the padding
+  unsigned int n_cubes() const { return (unsigned int)values_.size(); }
+
+  /// Number of storage positions of points, including the padding
+  unsigned int n_points() const { return (unsigned int)values_.size(); }
+
+  bool is_valid(CubeIdx _idx) const {
+    unsigned int x, y, z;
+    coordinates(_idx, x, y, z);
+    return (x+1 < x_res_ && y+1 < y_res_ && z+1 < z_res_);
+  }
+
+  PointIdx point_idx(CubeIdx _idx, unsigned char _corner) const {
+    PointIdx corners[8];
+    point_indices(_idx, corners);
+    return corners[_corner];
+  }
+
+  void point_indices(CubeIdx _idx, PointIdx _corners[8]) const;
+
+  /// Extractors visit the cubes brick by brick
+  unsigned int block_size() const { return BRICK_SIZE; }
+
+  /// Checks the signs of the brick's points and of the neighbors' points its cubes use
+  bool is_empty_block(CubeIdx _first) const;
+
+  OpenMesh::Vec3f point(PointIdx _idx) const {
+    unsigned int x, y, z;
+    coordinates(_idx, x, y, z);
+    return point(x, y, z);
+  }
+
+  virtual float scalar_distance(PointIdx _pidx) const {
+    return values_[_pidx];
+  }
+
+  virtual bool is_inside(PointIdx _pidx) const {
+    return values_[_pidx] < 0.0;
+  }
+
+  virtual bool directed_distance(const OpenMesh::Vec3f&  /*_p0*/,
+				 const OpenMesh::Vec3f&  /*_p1*/,
+				 OpenMesh::Vec3f&        /*_point*/,
+				 OpenMesh::Vec3f&        /*_normal*/,
+				 float&                  /*_distance*/) const {
+    return false;
+  }
+
+
+  //------------------------------------------------------------- grid layout
+
+  /// The 3D point at grid coordinates x,y,z
+  OpenMesh::Vec3f point(unsigned int _x, unsigned int _y, unsigned int _z) const {
+    return origin_ + dx_*(float)_x + dy_*(float)_y + dz_*(float)_z;
+  }
+
+  /// Storage position of the point at grid coordinates x,y,z
+  PointIdx point_idx(unsigned int _x, unsigned int _y, unsigned int _z) const {
+    return brick_index_[(_x>>3) + bx_*((_y>>3) + by_*(_z>>3))] * BRICK_SIZE
+      + (_x&7) + 8*(_y&7) + 64*(_z&7);
+  }
+
+  /// Grid coordinates of the storage position \b _idx
+  void coordinates(PointIdx _idx, unsigned int& _x, unsigned int& _y,
+		   unsigned int& _z) const {
+    unsigned int b = brick_coords_[_idx / BRICK_SIZE];
+    _x = ((b      ) & 1023)*BRICK + ( _idx     & 7);
+    _y = ((b >> 10) & 1023)*BRICK + ((_idx>>3) & 7);
+    _z = ((b >> 20) & 1023)*BRICK + ((_idx>>6) & 7);
+  }
+
+  const OpenMesh::Vec3f& origin() const { return origin_; }
+  const OpenMesh::Vec3f& x_axis() const { return x_axis_; }
+  const OpenMesh::Vec3f& y_axis() const { return y_axis_; }
+  const OpenMesh::Vec3f& z_axis() const { return z_axis_; }
+  unsigned int x_resolution() const { return x_res_; }
+  unsigned int y_resolution() const { return y_res_; }
+  unsigned int z_resolution() const { return z_res_; }
+
+
+  //------------------------------------------------------------------ values
+
+  /// Sample the scalar distance of \b _implicit in parallel
+  void sample(const Implicit& _implicit);
+
+  /** Sample an arbitrary functor in parallel, brick by brick. The
+      requirements on \b _func are the ones of IsoEx::sample_grid(), it
+      is called once per brick for all its BRICK_SIZE points; points in
+      the padding are evaluated outside of the grid. */
+  template <class Func>
+  void sample_function(const Func& _func) {
+    const int n_bricks = (int)brick_coords_.size();
+#pragma omp parallel
+    {
+      std::vector<float> x(BRICK_SIZE), y(BRICK_SIZE), z(BRICK_SIZE);
+#pragma omp for schedule(dynamic, 1)
+      for (int b=0; b<n_bricks; ++b)
+      {
+	for (int i=0; i<BRICK_SIZE; ++i)
+	{
+	  unsigned int gx, gy, gz;
+	  coordinates(b*BRICK_SIZE + i, gx, gy, gz);
+	  OpenMesh::Vec3f p = point(gx, gy, gz);
+	  x[i] = p[0];  y[i] = p[1];  z[i] = p[2];
+	}
+	_func(&x[0], &y[0], &z[0], BRICK_SIZE, &values_[b*BRICK_SIZE]);
+      }
+    }
+  }
+
+  Scalar& operator()(unsigned int x, unsigned int y, unsigned int z) {
+    return values_[point_idx(x, y, z)];
+  }
+  Scalar operator()(unsigned int x, unsigned int y, unsigned int z) const {
+    return values_[point_idx(x, y, z)];
+  }
+
+  /// All values in storage order, including the padding
+  const Values& values() const { return values_; }
+  Values& values() { return values_; }
+
+
+private:
+
+  OpenMesh::Vec3f   origin_, x_axis_, y_axis_, z_axis_, dx_, dy_, dz_;
+  unsigned int      x_res_, y_res_, z_res_;
+
+  // number of bricks per axis
+  unsigned int      bx_, by_, bz_;
+
+  // Morton rank of the brick at brick coordinates (x,y,z), x-fastest
+  std::vector<unsigned int>  brick_index_;
+
+  // brick coordinates of the brick with the given rank, 10 bits each
+  std::vector<unsigned int>  brick_coords_;
+
+  Values  values_;
+};
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
+#if defined(INCLUDE_TEMPLATES) && !defined(ISOEX_BRICKEDSCALARGRIDT_C)
+#define ISOEX_BRICKEDSCALARGRIDT_TEMPLATES
+#include "BrickedScalarGridT.cc"
+#endif
+//=============================================================================
+#endif // ISOEX_BRICKEDSCALARGRIDT_HH defined
+//=============================================================================
@@ -130,6 +130,27 @@ public:
   /// Return the PointIdx of the \b _corners'th corner of the cube \b _idx
   virtual PointIdx point_idx(CubeIdx _idx, unsigned char _corner) const = 0;
 
+  /** Return the PointIdx of all 8 corners of the cube \b _idx. Grids
+      can override this to decode the cube index only once. */
+  virtual void point_indices(CubeIdx _idx, PointIdx _corners[8]) const {
+    for (unsigned char i=0; i<8; ++i)
+      _corners[i] = point_idx(_idx, i);
+  }
+
+  /** Does \b _idx refer to a cube? Grids with padded storage, e.g.
+      IsoEx::BrickedScalarGridT, enumerate indices between begin() and
+      end() that do not. */
+  virtual bool is_valid(CubeIdx /*_idx*/) const { return true; }
+
+  /** Extractors visit the cubes in blocks of block_size() consecutive
+      indices. The default is a single block of all cubes. */
+  virtual unsigned int block_size() const { return n_cubes(); }
+
+  /** May return true if no cube of the block starting at \b _first
+      intersects the surface, i.e. all its corners are strictly inside
+      or strictly outside, so extractors can skip it. */
+  virtual bool is_empty_block(CubeIdx /*_first*/) const { return false; }
+
   /// Return the 3D point refered to by \b _idx.
   virtual OpenMesh::Vec3f  point(PointIdx _idx) const = 0;
 
@@ -0,0 +1,104 @@
+//=============================================================================
+//
+//  FUNCTION sample_grid
+//
+//=============================================================================
+
+
+#ifndef ISOEX_GRIDSAMPLER_HH
+#define ISOEX_GRIDSAMPLER_HH
+
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Grids/RegularGrid.hh>
+#include <IsoEx/Implicits/Implicit.hh>
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <vector>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== FUNCTION DEFINITION ======================================================
+
+
+/** Evaluate the functor \b _func at all points of the regular grid \b _grid
+    and store the results in \b _values, which is indexed by PointIdx and
+    has to hold n_points() entries. _func is called once per grid row
+    (fixed y and z) with the row's points in structure-of-arrays layout,
+    so it has to provide a thread-safe batch evaluation
+    <tt>operator()(const float* _x, const float* _y, const float* _z,
+    int _n, Value* _values) const</tt>.
+
+    The rows are distributed dynamically over all OpenMP threads. Every
+    value is computed independently of the others, so the result does not
+    depend on the number of threads.
+
+    \note Do not use a std::vector<bool> for _values, neighboring bits
+    share memory and would be written concurrently.
+
+    \ingroup grids
+*/
+template <class Func, class Value>
+void sample_grid(const RegularGrid& _grid, const Func& _func, Value* _values)
+{
+  const int nx(_grid.x_resolution()), ny(_grid.y_resolution());
+  const int n_rows(ny * _grid.z_resolution());
+
+#pragma omp parallel
+  {
+    std::vector<float> x(nx), y(nx), z(nx);
+
+#pragma omp for schedule(dynamic, 1)
+    for (int row=0; row<n_rows; ++row)
+    {
+      for (int i=0; i<nx; ++i)
+      {
+	OpenMesh::Vec3f p = _grid.point(i, row % ny, row / ny);
+	x[i] = p[0];  y[i] = p[1];  z[i] = p[2];
+      }
+      _func(&x[0], &y[0], &z[0], nx, _values + row*nx);
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// Adapts IsoEx::Implicit::scalar_distances() to sample_grid()
+class ScalarDistanceFunc
+{
+public:
+  ScalarDistanceFunc(const Implicit& _implicit) : implicit_(_implicit) {}
+  void operator()(const float* _x, const float* _y, const float* _z,
+		  int _n, float* _d) const
+  { implicit_.scalar_distances(_x, _y, _z, _n, _d); }
+private:
+  const Implicit& implicit_;
+};
+
+
+/// Adapts IsoEx::Implicit::is_inside() to sample_grid()
+class IsInsideFunc
+{
+public:
+  IsInsideFunc(const Implicit& _implicit) : implicit_(_implicit) {}
+  template <class Value>
+  void operator()(const float* _x, const float* _y, const float* _z,
+		  int _n, Value* _inside) const
+  {
+    for (int i=0; i<_n; ++i)
+      _inside[i] = implicit_.is_inside(OpenMesh::Vec3f(_x[i], _y[i], _z[i]));
+  }
+private:
+  const Implicit& implicit_;
+};
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
+#endif // ISOEX_GRIDSAMPLER_HH defined
+//=============================================================================
@@ -0,0 +1,122 @@
+//=============================================================================
+//
+//  CLASS ImplicitGrid - IMPLEMENTATION
+//
+//=============================================================================
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Grids/ImplicitGrid.hh>
+#include <algorithm>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== IMPLEMENTATION ==========================================================
+
+
+void
+ImplicitGrid::
+build_is_inside_cache() const
+{
+  int i, np(n_points()), nw((np + 63) / 64);
+
+  inside_bits_.clear();
+  if (!np) return;
+
+  // sample into bytes, then pack 64 of them into each word
+  std::vector<unsigned char> inside(np);
+  sample_grid(*this, IsInsideFunc(implicit_), &inside[0]);
+
+  inside_bits_.resize(nw + 1, 0);
+
+#pragma omp parallel for
+  for (i=0; i<nw; ++i)
+  {
+    const int first(64*i), last(std::min(first+64, np));
+    Word bits(0);
+    for (int j=last-1; j>=first; --j)
+      bits = (bits << 1) | (inside[j] != 0);
+    inside_bits_[i] = bits;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void
+ImplicitGrid::
+active_cubes(std::vector<CubeIdx>& _cubes) const
+{
+  _cubes.clear();
+  if (!n_cubes()) return;
+
+  if (inside_bits_.empty())
+    build_is_inside_cache();
+
+  const int nx(x_resolution()), ny(y_resolution()), nz(z_resolution());
+  const int layer(nx*ny);
+  int z;
+
+  // the cubes of each layer are collected in parallel
+  std::vector< std::vector<CubeIdx> > layers(nz-1);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (z=0; z<nz-1; ++z)
+  {
+    std::vector<CubeIdx>& cubes = layers[z];
+
+    for (int y=0; y<ny-1; ++y)
+    {
+      // first points of the 4 rows of corners of the row of cubes, and
+      // its first cube
+      const PointIdx  p0(y*nx + z*layer);
+      const PointIdx  p[4] = { p0, p0+nx, p0+layer, p0+layer+nx };
+      const CubeIdx   c(y*(nx-1) + z*(nx-1)*(ny-1));
+
+      for (int x=0; x<nx-1; x+=64)
+      {
+	// bit i of the words is cube x+i, its corners are x+i and x+i+1
+	// of the 4 rows
+	Word all_in(~Word(0)), any_in(0), bits;
+	for (int i=0; i<4; ++i)
+	{
+	  bits = inside_bits(p[i]+x);    all_in &= bits;  any_in |= bits;
+	  bits = inside_bits(p[i]+x+1);  all_in &= bits;  any_in |= bits;
+	}
+
+	Word active = any_in & ~all_in;
+	if (nx-1-x < 64)
+	  active &= (Word(1) << (nx-1-x)) - 1;
+
+	// the surface is sparse, skip empty bytes
+	for (int i=0; active; )
+	{
+	  if (!(active & 0xff))
+	  {
+	    active >>= 8;  i += 8;
+	    continue;
+	  }
+	  if (active & 1)
+	    cubes.push_back(c + x + i);
+	  active >>= 1;  ++i;
+	}
+      }
+    }
+  }
+
+  size_t n(0);
+  for (z=0; z<nz-1; ++z)
+    n += layers[z].size();
+
+  _cubes.reserve(n);
+  for (z=0; z<nz-1; ++z)
+    _cubes.insert(_cubes.end(), layers[z].begin(), layers[z].end());
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
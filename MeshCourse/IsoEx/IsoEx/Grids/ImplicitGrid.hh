@@ -12,8 +12,9 @@
 //== INCLUDES =================================================================
 
 #include <IsoEx/Grids/RegularGrid.hh>
+#include <IsoEx/Grids/GridSampler.hh>
 #include <IsoEx/Implicits/Implicit.hh>
-#include <OpenMesh/Core/Math/VectorT.hh>
+#include <OpenMesh/Core/Geometry/VectorT.hh>
 #include <vector>
 
 //== NAMESPACES ===============================================================
@@ -31,7 +32,9 @@ namespace IsoEx {
     implicit.
 
     In addition, this grid also provides caching of inside/outside tests and
-    scalar distance queries.
+    scalar distance queries. The inside/outside cache is bit-packed, one
+    bit per grid point in PointIdx order, and lets active_cubes() find
+    the cubes the surface passes through 64 cubes at a time.
 
     \ingroup grids
 */	      
@@ -65,9 +68,9 @@ public:
 
   /// See IsoEx::Implicit::is_inside()
   virtual bool is_inside(PointIdx _pidx) const {
-    return (is_inside_cache_.empty() ? 
+    return (inside_bits_.empty() ? 
 	    implicit_.is_inside(point(_pidx)) :
-	    is_inside_cache_[_pidx]);
+	    ((inside_bits_[_pidx >> 6] >> (_pidx & 63)) & 1) != 0);
   }
 
   /// See IsoEx::Implicit::scalar_distance()
@@ -94,38 +97,49 @@ public:
   //@{
 
   /// Cache results of is_inside()
-  void build_is_inside_cache() const
-  {
-    int i, np(n_points());
-    
-    is_inside_cache_.clear();
-    is_inside_cache_.resize(n_points());
-
-    for (i=0; i<np; ++i)
-      is_inside_cache_[i] = implicit_.is_inside(point(i));
-  }
+  void build_is_inside_cache() const;
 
   /// Cache results of scalar_distance()
   void build_scalar_distance_cache() const
   {
-    int i, np(n_points());
+    int np(n_points());
 
     scalar_distance_cache_.clear();
     scalar_distance_cache_.resize(np);
+    if (!np) return;
 
-    for (i=0; i<np; ++i)
-      scalar_distance_cache_[i] = implicit_.scalar_distance(point(i));
+    sample_grid(*this, ScalarDistanceFunc(implicit_), &scalar_distance_cache_[0]);
   }
 
   //@}
 
 
+
+  /** Collect the cubes whose corners are neither all inside nor all
+      outside, in increasing order, e.g. for the cube list variants of
+      marching_cubes() and extended_marching_cubes(). Uses the
+      inside/outside cache, which is built if necessary. */
+  void active_cubes(std::vector<CubeIdx>& _cubes) const;
+
+
  
 protected:
 
+  typedef unsigned long long  Word;
+
+  // the 64 inside bits of the points _pidx, _pidx+1, ..., _pidx+63
+  Word inside_bits(PointIdx _pidx) const {
+    unsigned int w(_pidx >> 6), s(_pidx & 63);
+    return (s ? 
+	    (inside_bits_[w] >> s) | (inside_bits_[w+1] << (64-s)) :
+	    inside_bits_[w]);
+  }
+
+
   const Implicit&     implicit_;
 
-  mutable std::vector<bool>   is_inside_cache_;
+  // bit-packed is_inside() cache, one padding word at the end
+  mutable std::vector<Word>   inside_bits_;
   mutable std::vector<float>  scalar_distance_cache_;
 };
 
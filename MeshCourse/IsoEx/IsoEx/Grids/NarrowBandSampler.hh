@@ -0,0 +1,617 @@
+//=============================================================================
+//
+//  FUNCTION sample_narrow_band
+//
+//=============================================================================
+
+
+#ifndef ISOEX_NARROWBANDSAMPLER_HH
+#define ISOEX_NARROWBANDSAMPLER_HH
+
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Grids/ScalarGridT.hh>
+#include <IsoEx/Grids/GridSampler.hh>
+#include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \class NarrowBandSamplerT NarrowBandSampler.hh <IsoEx/Grids/NarrowBandSampler.hh>
+
+    Adaptive sampling of a functor on a ScalarGridT close to its 0-level
+    set only. The cubes of the grid are subdivided by an octree from
+    coarse to fine. A block whose center value f(c) satisfies
+    |f(c)| > L * r, for its radius r and a Lipschitz constant L of f,
+    cannot contain the surface. It is culled and its grid points are set
+    to f(c), which has the right sign. Blocks of at most LEAF_SIZE^3 cubes
+    that cannot be culled are sampled exactly and their cubes are reported
+    as active cubes.
+
+    Marching Cubes restricted to the active cubes, see
+    IsoEx::marching_cubes(), produces the same mesh as on the densely
+    sampled grid, since all corners of cubes intersecting the surface
+    are sampled exactly.
+
+    This guarantee only holds for a true Lipschitz constant passed by the
+    caller. If none is given, L is estimated from the difference quotients
+    on a coarse grid, which is a heuristic: it may underestimate the slope
+    of f. Blocks culled with an estimated L are therefore checked by
+    sampling their 8 corners as well and are subdivided further if any
+    corner differs in sign from f(c). Surface components between the
+    corners of a block can still be missed.
+
+    The coarse grid consists of every s-th grid point, s chosen such
+    that it has at most COARSE_SIZE points per axis, so its values are
+    stored in the grid and never evaluated twice. It also predicts the
+    fraction of the grid close to the surface, i.e. where |f| <= L * r
+    for the radius r of a leaf. If culling would save less than half of
+    the evaluations, e.g. for functions that are small far from the
+    surface, the remaining grid points are sampled densely and the cubes
+    with a sign change are reported as active; this costs exactly as
+    many evaluations as dense sampling.
+
+    The band is a few leaves thick, so its share of the grid falls like
+    1/resolution and culling pays off only at higher resolutions. For a
+    triharmonic RBF fit of 1000 points, whose slope far from the surface
+    dominates the estimated L, the fallback is taken up to resolution
+    50; at 80 culling halves the evaluations, at 160 it saves a factor 5.
+
+    Use it through the convenience function
+    <b> IsoEx::sample_narrow_band() </b>. The functor has to provide the
+    batch evaluation described in IsoEx::sample_grid().
+
+    \ingroup grids
+*/
+template <class Func, class Scalar>
+class NarrowBandSamplerT
+{
+public:
+
+  typedef Grid::CubeIdx  CubeIdx;
+
+  /** Sample \b _func on \b _grid. \b _lipschitz is a Lipschitz constant
+      of _func, for values <= 0 it is estimated from a coarse sampling
+      and culled blocks are checked at their corners. The active cubes
+      are stored in \b _cubes in increasing order. */
+  NarrowBandSamplerT(ScalarGridT<Scalar>&   _grid,
+		     const Func&            _func,
+		     float                  _lipschitz,
+		     std::vector<CubeIdx>&  _cubes);
+
+  /// Number of function evaluations
+  unsigned int n_evaluations() const { return n_evaluations_; }
+
+  /// The Lipschitz constant used for culling
+  float lipschitz() const { return lipschitz_; }
+
+  /// Was the grid sampled densely since culling would not pay off?
+  bool dense() const { return dense_; }
+
+
+private:
+
+  // blocks with at most this many cubes per axis are sampled exactly
+  enum { LEAF_SIZE = 4 };
+
+  // the octree is expanded serially until there are this many blocks
+  enum { PARALLEL_BLOCKS = 64 };
+
+  // resolution of the coarse grid used to estimate L and the band
+  enum { COARSE_SIZE = 17 };
+
+  // range of grid points [x0,x1] x [y0,y1] x [z0,z1], i.e. the cubes
+  // [x0,x1) x [y0,y1) x [z0,z1)
+  struct Block
+  {
+    int     x0, y0, z0, x1, y1, z1;
+    int     size;    // size of the (unclipped) octree block in cubes
+    Scalar  value;   // function value at the center, culled blocks only
+  };
+
+  struct Result
+  {
+    std::vector<Block>  culled, leaves, open;
+    unsigned int        n_evaluations;
+  };
+
+  // every s-th grid point along each axis
+  struct Coarse
+  {
+    int                  nx, ny, nz;   // number of points
+    int                  sx, sy, sz;   // stride in grid points
+    std::vector<Scalar>  values;
+
+    Scalar operator()(int _x, int _y, int _z) const {
+      return values[_x + nx*(_y + ny*_z)];
+    }
+  };
+
+  // marks of the grid points, see sample_marked()
+  enum { SAMPLE = 1, COARSE = 2 };
+
+  void  subdivide(const Block& _block, Result& _result) const;
+  void  traverse(const Block& _block, Result& _result) const;
+  bool  corners_agree(Block* _blocks, int _n, Result& _result) const;
+  void  sample_coarse(Coarse& _coarse, std::vector<unsigned char>& _mark);
+  float estimate_lipschitz(const Coarse& _coarse) const;
+  float band_fraction(const Coarse& _coarse) const;
+  void  sample_marked(const Coarse& _coarse, const std::vector<unsigned char>& _mark);
+  void  sample_dense(const Coarse& _coarse, std::vector<unsigned char>& _mark,
+		     std::vector<CubeIdx>& _cubes);
+
+
+  ScalarGridT<Scalar>&  grid_;
+  const Func&           func_;
+  float                 lipschitz_;
+  bool                  verify_;
+  bool                  dense_;
+  unsigned int          n_evaluations_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+/** Convenience wrapper for NarrowBandSamplerT, returns the number of
+    function evaluations.
+    \ingroup grids
+*/
+template <class Func, class Scalar>
+unsigned int sample_narrow_band(ScalarGridT<Scalar>&         _grid,
+				const Func&                  _func,
+				float                        _lipschitz,
+				std::vector<Grid::CubeIdx>&  _cubes)
+{
+  NarrowBandSamplerT<Func, Scalar> sampler(_grid, _func, _lipschitz, _cubes);
+  return sampler.n_evaluations();
+}
+
+
+//== IMPLEMENTATION ===========================================================
+
+
+template <class Func, class Scalar>
+NarrowBandSamplerT<Func, Scalar>::
+NarrowBandSamplerT(ScalarGridT<Scalar>&   _grid,
+		   const Func&            _func,
+		   float                  _lipschitz,
+		   std::vector<CubeIdx>&  _cubes)
+  : grid_(_grid), func_(_func), lipschitz_(_lipschitz),
+    verify_(_lipschitz <= 0), dense_(false), n_evaluations_(0)
+{
+  const int nx(grid_.x_resolution()), ny(grid_.y_resolution()),
+            nz(grid_.z_resolution());
+  int i, x, y, z;
+
+  _cubes.clear();
+  if (nx < 2 || ny < 2 || nz < 2)
+    return;
+
+  // coarse sampling to estimate L and the size of the band
+  std::vector<unsigned char> mark(grid_.n_points(), 0);
+  Coarse coarse;
+  sample_coarse(coarse, mark);
+
+  if (verify_)
+    lipschitz_ = estimate_lipschitz(coarse);
+
+  if (band_fraction(coarse) > 0.5f)
+  {
+    sample_dense(coarse, mark, _cubes);
+    return;
+  }
+
+
+  // root block: power of two covering all cubes
+  Block root;
+  root.size = 1;
+  while (root.size < std::max(nx, std::max(ny, nz)) - 1)
+    root.size *= 2;
+  root.x0 = root.y0 = root.z0 = 0;
+  root.x1 = nx-1;  root.y1 = ny-1;  root.z1 = nz-1;
+
+
+  // expand the top levels serially
+  Result top;
+  top.n_evaluations = 0;
+  top.open.push_back(root);
+  while (!top.open.empty() && top.open.size() < PARALLEL_BLOCKS)
+  {
+    std::vector<Block> open;
+    open.swap(top.open);
+    for (i=0; i<(int)open.size(); ++i)
+      subdivide(open[i], top);
+  }
+
+
+  // traverse the remaining subtrees in parallel
+  const int n_open(top.open.size());
+  std::vector<Result> results(n_open);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (i=0; i<n_open; ++i)
+  {
+    results[i].n_evaluations = 0;
+    traverse(top.open[i], results[i]);
+  }
+
+  results.push_back(top);
+  for (i=0; i<(int)results.size(); ++i)
+    n_evaluations_ += results[i].n_evaluations;
+
+
+  // fill culled blocks with their center value, in a fixed order
+  for (i=0; i<(int)results.size(); ++i)
+  {
+    const std::vector<Block>& culled = results[i].culled;
+    for (unsigned int b=0; b<culled.size(); ++b)
+      for (z=culled[b].z0; z<=culled[b].z1; ++z)
+	for (y=culled[b].y0; y<=culled[b].y1; ++y)
+	  for (x=culled[b].x0; x<=culled[b].x1; ++x)
+	    grid_(x, y, z) = culled[b].value;
+  }
+
+
+  // mark the points of the leaves, collect their cubes
+  for (i=0; i<(int)results.size(); ++i)
+  {
+    const std::vector<Block>& leaves = results[i].leaves;
+    for (unsigned int b=0; b<leaves.size(); ++b)
+      for (z=leaves[b].z0; z<=leaves[b].z1; ++z)
+	for (y=leaves[b].y0; y<=leaves[b].y1; ++y)
+	  for (x=leaves[b].x0; x<=leaves[b].x1; ++x)
+	  {
+	    mark[x + nx*(y + ny*z)] |= SAMPLE;
+	    if (x < leaves[b].x1 && y < leaves[b].y1 && z < leaves[b].z1)
+	      _cubes.push_back(x + (nx-1)*(y + (ny-1)*z));
+	  }
+  }
+  std::sort(_cubes.begin(), _cubes.end());
+
+  sample_marked(coarse, mark);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Scalar>
+void
+NarrowBandSamplerT<Func, Scalar>::
+sample_coarse(Coarse& _coarse, std::vector<unsigned char>& _mark)
+{
+  const int nx(grid_.x_resolution()), ny(grid_.y_resolution()),
+            nz(grid_.z_resolution());
+
+  _coarse.sx = (nx - 1 + COARSE_SIZE - 2) / (COARSE_SIZE - 1);
+  _coarse.sy = (ny - 1 + COARSE_SIZE - 2) / (COARSE_SIZE - 1);
+  _coarse.sz = (nz - 1 + COARSE_SIZE - 2) / (COARSE_SIZE - 1);
+  _coarse.nx = (nx - 1) / _coarse.sx + 1;
+  _coarse.ny = (ny - 1) / _coarse.sy + 1;
+  _coarse.nz = (nz - 1) / _coarse.sz + 1;
+  _coarse.values.resize(_coarse.nx * _coarse.ny * _coarse.nz);
+
+  // row by row like sample_grid(), at the grid's own points
+  const int n_rows(_coarse.ny * _coarse.nz);
+
+#pragma omp parallel
+  {
+    std::vector<float> px(_coarse.nx), py(_coarse.nx), pz(_coarse.nx);
+
+#pragma omp for schedule(dynamic, 1)
+    for (int row=0; row<n_rows; ++row)
+    {
+      const int y((row % _coarse.ny) * _coarse.sy),
+                z((row / _coarse.ny) * _coarse.sz);
+      for (int i=0; i<_coarse.nx; ++i)
+      {
+	OpenMesh::Vec3f p = grid_.point(i * _coarse.sx, y, z);
+	px[i] = p[0];  py[i] = p[1];  pz[i] = p[2];
+      }
+      func_(&px[0], &py[0], &pz[0], _coarse.nx,
+	    &_coarse.values[row * _coarse.nx]);
+    }
+  }
+  n_evaluations_ += (unsigned int)_coarse.values.size();
+
+  for (int z=0; z<_coarse.nz; ++z)
+    for (int y=0; y<_coarse.ny; ++y)
+      for (int x=0; x<_coarse.nx; ++x)
+	_mark[x*_coarse.sx + nx*(y*_coarse.sy + ny*z*_coarse.sz)] = COARSE;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Scalar>
+void
+NarrowBandSamplerT<Func, Scalar>::
+sample_marked(const Coarse& _coarse, const std::vector<unsigned char>& _mark)
+{
+  // points marked SAMPLE are evaluated, the ones also marked COARSE get
+  // their coarse value back, which a culled block may have overwritten
+  const int nx(grid_.x_resolution()), ny(grid_.y_resolution()),
+            nz(grid_.z_resolution());
+  const int n_rows(ny*nz);
+  unsigned int n_samples(0);
+
+#pragma omp parallel reduction(+:n_samples)
+  {
+    std::vector<float>  px(nx), py(nx), pz(nx);
+    std::vector<Scalar> values(nx);
+    std::vector<int>    index(nx);
+
+#pragma omp for schedule(dynamic, 1)
+    for (int row=0; row<n_rows; ++row)
+    {
+      const unsigned char* s = &_mark[row*nx];
+      const int y(row % ny), z(row / ny);
+      int n(0);
+      for (int j=0; j<nx; ++j)
+      {
+	if (!(s[j] & SAMPLE)) continue;
+	if (s[j] & COARSE)
+	{
+	  grid_(j, y, z) = _coarse(j / _coarse.sx, y / _coarse.sy, z / _coarse.sz);
+	  continue;
+	}
+	OpenMesh::Vec3f p = grid_.point(j, y, z);
+	px[n] = p[0];  py[n] = p[1];  pz[n] = p[2];
+	index[n++] = j;
+      }
+      if (!n) continue;
+
+      func_(&px[0], &py[0], &pz[0], n, &values[0]);
+      for (int j=0; j<n; ++j)
+	grid_(index[j], y, z) = values[j];
+      n_samples += n;
+    }
+  }
+  n_evaluations_ += n_samples;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Scalar>
+void
+NarrowBandSamplerT<Func, Scalar>::
+subdivide(const Block& _block, Result& _result) const
+{
+  if (_block.size <= LEAF_SIZE)
+  {
+    _result.leaves.push_back(_block);
+    return;
+  }
+
+  // children, clipped to the grid
+  Block  children[8];
+  float  cx[8], cy[8], cz[8], radius[8];
+  Scalar values[8];
+  int    i, n(0);
+  const int half(_block.size / 2);
+
+  const OpenMesh::Vec3f
+    dx(grid_.x_axis() / (float)(grid_.x_resolution()-1)),
+    dy(grid_.y_axis() / (float)(grid_.y_resolution()-1)),
+    dz(grid_.z_axis() / (float)(grid_.z_resolution()-1));
+
+  for (i=0; i<8; ++i)
+  {
+    Block& c = children[n];
+    c.size = half;
+    c.x0 = _block.x0 + ((i&1) ? half : 0);
+    c.y0 = _block.y0 + ((i&2) ? half : 0);
+    c.z0 = _block.z0 + ((i&4) ? half : 0);
+    if (c.x0 >= _block.x1 || c.y0 >= _block.y1 || c.z0 >= _block.z1)
+      continue;
+    c.x1 = std::min(c.x0 + half, _block.x1);
+    c.y1 = std::min(c.y0 + half, _block.y1);
+    c.z1 = std::min(c.z0 + half, _block.z1);
+
+    // bounding sphere of the block's parallelepiped
+    OpenMesh::Vec3f
+      center = grid_.origin()
+               + dx * (0.5f * (c.x0 + c.x1))
+               + dy * (0.5f * (c.y0 + c.y1))
+               + dz * (0.5f * (c.z0 + c.z1)),
+      a = dx * (float)(c.x1 - c.x0),
+      b = dy * (float)(c.y1 - c.y0),
+      d = dz * (float)(c.z1 - c.z0);
+    radius[n] = 0.5f * std::max(std::max((a+b+d).norm(), (a+b-d).norm()),
+				std::max((a-b+d).norm(), (a-b-d).norm()));
+
+    cx[n] = center[0];  cy[n] = center[1];  cz[n] = center[2];
+    ++n;
+  }
+
+  func_(cx, cy, cz, n, values);
+  _result.n_evaluations += n;
+
+  Block candidates[8];
+  int   n_candidates(0);
+
+  for (i=0; i<n; ++i)
+  {
+    if (std::fabs(values[i]) > lipschitz_ * radius[i])
+    {
+      children[i].value = values[i];
+      candidates[n_candidates++] = children[i];
+    }
+    else
+      _result.open.push_back(children[i]);
+  }
+
+  if (n_candidates && verify_ &&
+      !corners_agree(candidates, n_candidates, _result))
+  {
+    // the estimated L is too small here, do not trust it for these blocks
+    for (i=0; i<n_candidates; ++i)
+      _result.open.push_back(candidates[i]);
+    return;
+  }
+
+  for (i=0; i<n_candidates; ++i)
+    _result.culled.push_back(candidates[i]);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Scalar>
+bool
+NarrowBandSamplerT<Func, Scalar>::
+corners_agree(Block* _blocks, int _n, Result& _result) const
+{
+  // the 8 corners of all blocks in one batch
+  float  px[64], py[64], pz[64];
+  Scalar values[64];
+  int    i, j, m(0);
+
+  for (i=0; i<_n; ++i)
+  {
+    const Block& b = _blocks[i];
+    for (j=0; j<8; ++j, ++m)
+    {
+      OpenMesh::Vec3f p = grid_.point((j&1) ? b.x1 : b.x0,
+				      (j&2) ? b.y1 : b.y0,
+				      (j&4) ? b.z1 : b.z0);
+      px[m] = p[0];  py[m] = p[1];  pz[m] = p[2];
+    }
+  }
+
+  func_(px, py, pz, m, values);
+  _result.n_evaluations += m;
+
+  for (i=0, m=0; i<_n; ++i)
+    for (j=0; j<8; ++j, ++m)
+      if ((values[m] > 0) != (_blocks[i].value > 0))
+	return false;
+
+  return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Scalar>
+void
+NarrowBandSamplerT<Func, Scalar>::
+traverse(const Block& _block, Result& _result) const
+{
+  _result.open.push_back(_block);
+  while (!_result.open.empty())
+  {
+    Block block = _result.open.back();
+    _result.open.pop_back();
+    subdivide(block, _result);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Scalar>
+float
+NarrowBandSamplerT<Func, Scalar>::
+estimate_lipschitz(const Coarse& _coarse) const
+{
+  // largest difference quotient on the coarse grid, without a safety
+  // factor since culled blocks are checked at their corners
+  const float
+    hx((grid_.x_axis() * ((float)_coarse.sx / (grid_.x_resolution()-1))).norm()),
+    hy((grid_.y_axis() * ((float)_coarse.sy / (grid_.y_resolution()-1))).norm()),
+    hz((grid_.z_axis() * ((float)_coarse.sz / (grid_.z_resolution()-1))).norm());
+  float L(0);
+
+  for (int z=0; z<_coarse.nz; ++z)
+    for (int y=0; y<_coarse.ny; ++y)
+      for (int x=0; x<_coarse.nx; ++x)
+      {
+	const float f(_coarse(x, y, z));
+	if (x+1<_coarse.nx) L = std::max(L, (float)std::fabs(_coarse(x+1, y, z) - f) / hx);
+	if (y+1<_coarse.ny) L = std::max(L, (float)std::fabs(_coarse(x, y+1, z) - f) / hy);
+	if (z+1<_coarse.nz) L = std::max(L, (float)std::fabs(_coarse(x, y, z+1) - f) / hz);
+      }
+
+  return L;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Scalar>
+float
+NarrowBandSamplerT<Func, Scalar>::
+band_fraction(const Coarse& _coarse) const
+{
+  // radius of a leaf block, leaves closer to the surface are sampled
+  const float r = 0.5f * LEAF_SIZE *
+    ( grid_.x_axis() / (float)(grid_.x_resolution()-1)
+    + grid_.y_axis() / (float)(grid_.y_resolution()-1)
+    + grid_.z_axis() / (float)(grid_.z_resolution()-1) ).norm();
+
+  unsigned int n_band(0);
+  for (unsigned int i=0; i<_coarse.values.size(); ++i)
+    if (std::fabs(_coarse.values[i]) <= lipschitz_ * r)
+      ++n_band;
+
+  return (float)n_band / (float)_coarse.values.size();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Func, class Scalar>
+void
+NarrowBandSamplerT<Func, Scalar>::
+sample_dense(const Coarse& _coarse, std::vector<unsigned char>& _mark,
+	     std::vector<CubeIdx>& _cubes)
+{
+  // all points but the coarse ones
+  dense_ = true;
+  for (unsigned int i=0; i<_mark.size(); ++i)
+    _mark[i] |= SAMPLE;
+  sample_marked(_coarse, _mark);
+
+  // active cubes are the ones with a sign change, classified as in
+  // MarchingCubesT
+  const int nx(grid_.x_resolution()), ny(grid_.y_resolution()),
+            nz(grid_.z_resolution());
+
+  for (int z=0; z<nz-1; ++z)
+    for (int y=0; y<ny-1; ++y)
+      for (int x=0; x<nx-1; ++x)
+      {
+	const bool outside(grid_(x, y, z) > 0);
+	for (int j=1; j<8; ++j)
+	  if ((grid_(x + (j&1), y + ((j>>1)&1), z + (j>>2)) > 0) != outside)
+	  {
+	    _cubes.push_back(x + (nx-1)*(y + (ny-1)*z));
+	    break;
+	  }
+      }
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
+#endif // ISOEX_NARROWBANDSAMPLER_HH defined
+//=============================================================================
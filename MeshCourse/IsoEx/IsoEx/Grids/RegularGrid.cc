@@ -108,6 +108,20 @@ point_idx(CubeIdx _idx, unsigned char _corner) const
 //-----------------------------------------------------------------------------
 
 
+void
+RegularGrid::
+point_indices(CubeIdx _idx, PointIdx _corners[8]) const
+{
+  // decode the cube coordinates once for all corners
+  _corners[0] = point_idx(_idx, 0);
+  for (unsigned int i=1; i<8; ++i)
+    _corners[i] = _corners[0] + offsets_[i];
+}
+
+
+//-----------------------------------------------------------------------------
+
+
 OpenMesh::Vec3f
 RegularGrid::
 point(PointIdx _idx) const
@@ -93,6 +93,9 @@ public:
   /// Return the PointIdx of the \b _corners'th corner of the cube \b _idx
   PointIdx point_idx(CubeIdx _idx, unsigned char _corner) const;
 
+  /// Return the PointIdx of all 8 corners of the cube \b _idx
+  void point_indices(CubeIdx _idx, PointIdx _corners[8]) const;
+
   /// Return the 3D point refered to by \b _idx.
   OpenMesh::Vec3f  point(PointIdx _idx) const;
 
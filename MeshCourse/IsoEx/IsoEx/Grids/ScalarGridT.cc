@@ -23,8 +23,7 @@ void
 ScalarGridT<Scalar>::
 sample(const Implicit& _implicit)
 {
-  for (unsigned int i=0; i<n_points(); ++i)
-    values_[i] = _implicit.scalar_distance(point(i));
+  sample_function(ScalarDistanceFunc(_implicit));
 }
 
 
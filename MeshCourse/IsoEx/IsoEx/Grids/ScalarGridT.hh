@@ -15,6 +15,7 @@
 #include <OpenMesh/Core/IO/BinaryHelper.hh>
 #include <OpenMesh/Core/Geometry/VectorT.hh>
 #include <IsoEx/Grids/RegularGrid.hh>
+#include <IsoEx/Grids/GridSampler.hh>
 #include <IsoEx/Implicits/Implicit.hh>
 #include <vector>
 #include <iostream>
@@ -74,8 +75,17 @@ public:
     return false;
   }
 
+  /// Sample the scalar distance of \b _implicit in parallel
   void sample(const Implicit& _implicit);
 
+  /** Sample an arbitrary functor in parallel, see IsoEx::sample_grid()
+      for the requirements on \b _func */
+  template <class Func>
+  void sample_function(const Func& _func) {
+    if (!values_.empty())
+      sample_grid(*this, _func, &values_[0]);
+  }
+
 
   virtual bool read(const char* _filename);
   virtual bool write(const char* _filename);
@@ -101,6 +111,10 @@ public:
 
   void resize() {values_ = Values(n_points(), 0);};  // changed
 
+  /// All values, x varies fastest, then y, then z
+  const Values& values() const { return values_; }
+  Values& values() { return values_; }
+
 
 private:
   
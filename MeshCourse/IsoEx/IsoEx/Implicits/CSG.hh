@@ -37,12 +37,76 @@
 //== INCLUDES =================================================================
 
 #include <IsoEx/Implicits/Implicit.hh>
+#include <IsoEx/Math/SSE.hh>
+#include <algorithm>
 
 //== NAMESPACES ===============================================================
 
 namespace IsoEx {
 namespace CSG {
 
+//== HELPERS ==================================================================
+
+
+/** \internal Evaluates the batch scalar distances of both operands chunk by
+    chunk and combines them by Op::apply(), the result of \b _implicit1 is
+    computed in place in \b _d.
+*/
+template <class Op>
+void combine_distances(const Implicit& _implicit1, const Implicit& _implicit2,
+		       const float* _x, const float* _y, const float* _z,
+		       int _n, float* _d)
+{
+  enum { CHUNK = 256 };
+  float d2[CHUNK];
+
+  for (int i=0; i<_n; i+=CHUNK)
+  {
+    int m = std::min(int(CHUNK), _n-i), j(0);
+    float* d1 = _d+i;
+
+    _implicit1.scalar_distances(_x+i, _y+i, _z+i, m, d1);
+    _implicit2.scalar_distances(_x+i, _y+i, _z+i, m, d2);
+
+#ifdef ISOEX_SSE2
+    for (; j+4<=m; j+=4)
+      _mm_storeu_ps(d1+j, Op::apply(_mm_loadu_ps(d1+j), _mm_loadu_ps(d2+j)));
+#endif
+    for (; j<m; ++j)
+      d1[j] = Op::apply(d1[j], d2[j]);
+  }
+}
+
+
+/// \internal min(d1, d2), the distance of a union
+struct UnionOp
+{
+  static float apply(float _d1, float _d2) { return std::min(_d1, _d2); }
+#ifdef ISOEX_SSE2
+  static __m128 apply(__m128 _d1, __m128 _d2) { return _mm_min_ps(_d1, _d2); }
+#endif
+};
+
+/// \internal max(d1, d2), the distance of an intersection
+struct IntersectionOp
+{
+  static float apply(float _d1, float _d2) { return std::max(_d1, _d2); }
+#ifdef ISOEX_SSE2
+  static __m128 apply(__m128 _d1, __m128 _d2) { return _mm_max_ps(_d1, _d2); }
+#endif
+};
+
+/// \internal max(d1, -d2), the distance of a difference
+struct DifferenceOp
+{
+  static float apply(float _d1, float _d2) { return std::max(_d1, -_d2); }
+#ifdef ISOEX_SSE2
+  static __m128 apply(__m128 _d1, __m128 _d2) {
+    return _mm_max_ps(_d1, _mm_xor_ps(_d2, _mm_set1_ps(-0.0f)));
+  }
+#endif
+};
+
 //== CLASS DEFINITION =========================================================
 
 
@@ -94,8 +158,17 @@ public:
     return false;
   }
 
+  void   scalar_distances(const float* _x, const float* _y, const float* _z,
+			  int _n, float* _d) const {
+    combine_distances<UnionOp>(implicit1_, implicit2_, _x, _y, _z, _n, _d);
+  }
+
   //@}
 
+  /// The operands, e.g. for IsoEx::CompiledCSG
+  const Implicit& implicit1() const { return implicit1_; }
+  const Implicit& implicit2() const { return implicit2_; }
+
 private:
 
   const Implicit& implicit1_;
@@ -155,9 +228,18 @@ public:
     
     return false;
   }
+
+  void   scalar_distances(const float* _x, const float* _y, const float* _z,
+			  int _n, float* _d) const {
+    combine_distances<IntersectionOp>(implicit1_, implicit2_, _x, _y, _z, _n, _d);
+  }
   
   //@}
 
+  /// The operands, e.g. for IsoEx::CompiledCSG
+  const Implicit& implicit1() const { return implicit1_; }
+  const Implicit& implicit2() const { return implicit2_; }
+
 
 private:
 
@@ -221,9 +303,18 @@ public:
     
     return false;
   }
+
+  void   scalar_distances(const float* _x, const float* _y, const float* _z,
+			  int _n, float* _d) const {
+    combine_distances<DifferenceOp>(implicit1_, implicit2_, _x, _y, _z, _n, _d);
+  }
   
   //@}
 
+  /// The operands, e.g. for IsoEx::CompiledCSG
+  const Implicit& implicit1() const { return implicit1_; }
+  const Implicit& implicit2() const { return implicit2_; }
+
 private:
 
   const Implicit& implicit1_;
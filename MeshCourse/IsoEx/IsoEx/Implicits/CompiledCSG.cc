@@ -0,0 +1,608 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------* 
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+//=============================================================================
+//
+//  CLASS CompiledCSG - IMPLEMENTATION
+//
+//=============================================================================
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Implicits/CompiledCSG.hh>
+#include <IsoEx/Implicits/CSG.hh>
+#include <IsoEx/Implicits/ImplicitSphere.hh>
+#include <IsoEx/Math/SSE.hh>
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== HELPERS ==================================================================
+
+
+/// \internal Combines two registers by Op::apply(), see CSG::combine_distances()
+template <class Op>
+static void combine(const float* _a, const float* _b, int _n, float* _d)
+{
+  int i(0);
+#ifdef ISOEX_SSE2
+  for (; i+4<=_n; i+=4)
+    _mm_storeu_ps(_d+i, Op::apply(_mm_loadu_ps(_a+i), _mm_loadu_ps(_b+i)));
+#endif
+  for (; i<_n; ++i)
+    _d[i] = Op::apply(_a[i], _b[i]);
+}
+
+
+/// \internal Sphere distances, computed exactly like ImplicitSphere does
+static void sphere_distances(const OpenMesh::Vec3f& _center, float _radius,
+			     const float* _x, const float* _y, const float* _z,
+			     int _n, float* _d)
+{
+  int i(0);
+
+#ifdef ISOEX_SSE2
+  const __m128 cx(_mm_set1_ps(_center[0])), cy(_mm_set1_ps(_center[1])),
+               cz(_mm_set1_ps(_center[2])), r(_mm_set1_ps(_radius));
+
+  for (; i+4<=_n; i+=4)
+  {
+    __m128 dx = _mm_sub_ps(cx, _mm_loadu_ps(_x+i));
+    __m128 dy = _mm_sub_ps(cy, _mm_loadu_ps(_y+i));
+    __m128 dz = _mm_sub_ps(cz, _mm_loadu_ps(_z+i));
+    __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+			   _mm_mul_ps(dz, dz));
+    _mm_storeu_ps(_d+i, _mm_sub_ps(_mm_sqrt_ps(d2), r));
+  }
+#endif
+
+  for (; i<_n; ++i)
+    _d[i] = (_center - OpenMesh::Vec3f(_x[i], _y[i], _z[i])).norm() - _radius;
+}
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+CompiledCSG::
+CompiledCSG(const Implicit& _root)
+  : root_(_root)
+{
+  RegisterCount count;
+  n_registers_ = registers(root_, count);
+  compile(root_, 0, count);
+
+  tape_.resize(code_.size());
+  for (unsigned int i=0; i<code_.size(); ++i)
+  {
+    tape_[i].instruction = i;
+    tape_[i].a           = code_[i].a;
+    tape_[i].b           = code_[i].b;
+    tape_[i].mode        = EVALUATE;
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool
+CompiledCSG::
+is_operator(const Implicit& _node, OpCode& _op,
+	    const Implicit*& _a, const Implicit*& _b)
+{
+  if (const CSG::Union* u = dynamic_cast<const CSG::Union*>(&_node))
+  {
+    _op = UNION;  _a = &u->implicit1();  _b = &u->implicit2();
+    return true;
+  }
+  if (const CSG::Intersection* i = dynamic_cast<const CSG::Intersection*>(&_node))
+  {
+    _op = INTERSECTION;  _a = &i->implicit1();  _b = &i->implicit2();
+    return true;
+  }
+  if (const CSG::Difference* d = dynamic_cast<const CSG::Difference*>(&_node))
+  {
+    _op = DIFFERENCE;  _a = &d->implicit1();  _b = &d->implicit2();
+    return true;
+  }
+  return false;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int
+CompiledCSG::
+registers(const Implicit& _node, RegisterCount& _count) const
+{
+  RegisterCount::const_iterator it = _count.find(&_node);
+  if (it != _count.end())
+    return it->second;
+
+  OpCode          op;
+  const Implicit  *a, *b;
+  int             n(1);
+
+  if (is_operator(_node, op, a, b))
+  {
+    int na(registers(*a, _count)), nb(registers(*b, _count));
+    n = (na == nb) ? na+1 : std::max(na, nb);
+  }
+
+  _count[&_node] = n;
+  return n;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int
+CompiledCSG::
+compile(const Implicit& _node, int _reg, RegisterCount& _count)
+{
+  OpCode          op;
+  const Implicit  *a, *b;
+  Instruction     in;
+
+  in.reg    = _reg;
+  in.a      = in.b = -1;
+  in.center = OpenMesh::Vec3f(0,0,0);
+  in.radius = 0.0f;
+  in.leaf   = &_node;
+
+  if (is_operator(_node, op, a, b))
+  {
+    // the operand needing more registers first, the other one goes to
+    // the next register
+    in.op = op;
+    if (registers(*a, _count) >= registers(*b, _count))
+    {
+      in.a = compile(*a, _reg,   _count);
+      in.b = compile(*b, _reg+1, _count);
+    }
+    else
+    {
+      in.b = compile(*b, _reg,   _count);
+      in.a = compile(*a, _reg+1, _count);
+    }
+  }
+  else if (const ImplicitSphere* s = dynamic_cast<const ImplicitSphere*>(&_node))
+  {
+    in.op     = SPHERE;
+    in.center = s->center();
+    in.radius = s->radius();
+  }
+  else
+  {
+    in.op = LEAF;
+  }
+
+  code_.push_back(in);
+  return (int)code_.size()-1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool
+CompiledCSG::
+is_inside(const OpenMesh::Vec3f& _p) const
+{
+  assert(n_registers_ <= MAX_REGISTERS);
+  bool inside[MAX_REGISTERS];
+
+  for (unsigned int i=0; i<code_.size(); ++i)
+  {
+    const Instruction& in = code_[i];
+    bool& r = inside[in.reg];
+
+    switch (in.op)
+    {
+      case SPHERE:
+	r = (in.center - _p).sqrnorm() <= in.radius*in.radius;
+	break;
+      case LEAF:
+	r = in.leaf->is_inside(_p);
+	break;
+      case UNION:
+	r = inside[code_[in.a].reg] || inside[code_[in.b].reg];
+	break;
+      case INTERSECTION:
+	r = inside[code_[in.a].reg] && inside[code_[in.b].reg];
+	break;
+      case DIFFERENCE:
+	r = inside[code_[in.a].reg] && !inside[code_[in.b].reg];
+	break;
+    }
+  }
+
+  return inside[code_.back().reg];
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+float
+CompiledCSG::
+scalar_distance(const OpenMesh::Vec3f& _p) const
+{
+  assert(n_registers_ <= MAX_REGISTERS);
+  float d[MAX_REGISTERS];
+
+  for (unsigned int i=0; i<code_.size(); ++i)
+  {
+    const Instruction& in = code_[i];
+    float& r = d[in.reg];
+
+    switch (in.op)
+    {
+      case SPHERE:
+	r = (in.center - _p).norm() - in.radius;
+	break;
+      case LEAF:
+	r = in.leaf->scalar_distance(_p);
+	break;
+      case UNION:
+	r = std::min(d[code_[in.a].reg], d[code_[in.b].reg]);
+	break;
+      case INTERSECTION:
+	r = std::max(d[code_[in.a].reg], d[code_[in.b].reg]);
+	break;
+      case DIFFERENCE:
+	r = std::max(d[code_[in.a].reg], -d[code_[in.b].reg]);
+	break;
+    }
+  }
+
+  return d[code_.back().reg];
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void
+CompiledCSG::
+scalar_distances(const float* _x, const float* _y, const float* _z,
+		 int _n, float* _d) const
+{
+  if (_n <= 0)
+    return;
+
+  Workspace ws;
+  ws.lo.resize(code_.size());
+  ws.hi.resize(code_.size());
+  ws.needed.resize(code_.size(), 0);
+  ws.bound.resize(code_.size());
+  ws.alias.resize(code_.size());
+  ws.registers.resize(n_registers_ * CHUNK);
+
+  // one tape per level of the subdivision, see evaluate_range()
+  unsigned int levels(2);
+  for (int q=_n/CHUNK; q>1; q=(q+1)/2)
+    ++levels;
+  ws.tapes.resize(levels);
+
+  evaluate_range(tape_, 0, _x, _y, _z, 0, _n, _d, ws);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void
+CompiledCSG::
+evaluate_range(const Tape& _tape, unsigned int _level,
+	       const float* _x, const float* _y, const float* _z,
+	       int _first, int _last, float* _d, Workspace& _ws) const
+{
+  // bounding box of the points
+  float bmin[3] = { _x[_first], _y[_first], _z[_first] };
+  float bmax[3] = { _x[_first], _y[_first], _z[_first] };
+  for (int i=_first+1; i<_last; ++i)
+  {
+    bmin[0] = std::min(bmin[0], _x[i]);  bmax[0] = std::max(bmax[0], _x[i]);
+    bmin[1] = std::min(bmin[1], _y[i]);  bmax[1] = std::max(bmax[1], _y[i]);
+    bmin[2] = std::min(bmin[2], _z[i]);  bmax[2] = std::max(bmax[2], _z[i]);
+  }
+
+  assert(_level < _ws.tapes.size());
+  Tape& pruned = _ws.tapes[_level];
+  prune(_tape, bmin, bmax, pruned, _ws);
+
+
+  // split at a multiple of CHUNK, so the vectorized loops see the same
+  // groups of 4 points as the ones of the tree
+  const int n(_last-_first);
+  if (n <= CHUNK)
+  {
+    evaluate(pruned, _x+_first, _y+_first, _z+_first, n, _d+_first, _ws);
+  }
+  else
+  {
+    const int mid = _first + (n/CHUNK + 1)/2 * CHUNK;
+    evaluate_range(pruned, _level+1, _x, _y, _z, _first, mid,  _d, _ws);
+    evaluate_range(pruned, _level+1, _x, _y, _z, mid,    _last, _d, _ws);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void
+CompiledCSG::
+prune(const Tape& _tape, const float _bmin[3], const float _bmax[3],
+      Tape& _pruned, Workspace& _ws) const
+{
+  std::vector<float>&          lo     = _ws.lo;
+  std::vector<float>&          hi     = _ws.hi;
+  std::vector<unsigned char>&  needed = _ws.needed;
+  int                          i;
+
+
+  // intervals of the distances over the box, bottom up. The ones of the
+  // spheres are widened by the rounding error of their evaluation, so
+  // dropped operands never change a result.
+  for (i=0; i<(int)_tape.size(); ++i)
+  {
+    const int          k  = _tape[i].instruction;
+    const int          sa = _tape[i].a, sb = _tape[i].b;
+    const Instruction& in = code_[k];
+
+    switch (_tape[i].mode)
+    {
+      case COPY_A:    lo[k] = lo[sa];   hi[k] = hi[sa];   continue;
+      case COPY_B:    lo[k] = lo[sb];   hi[k] = hi[sb];   continue;
+      case NEGATE_B:  lo[k] = -hi[sb];  hi[k] = -lo[sb];  continue;
+      default:        break;
+    }
+
+    switch (in.op)
+    {
+      case SPHERE:
+      {
+	float nearest2(0.0f), farthest2(0.0f);
+	for (int j=0; j<3; ++j)
+	{
+	  const float c(in.center[j]), d0(_bmin[j]-c), d1(c-_bmax[j]);
+	  const float d(std::max(0.0f, std::max(d0, d1)));
+	  const float f(std::max(fabs(d0), fabs(d1)));
+	  nearest2  += d*d;
+	  farthest2 += f*f;
+	}
+	const float nearest(sqrt(nearest2)), farthest(sqrt(farthest2));
+	const float eps(1e-5f * (farthest + fabs(in.radius)));
+	lo[k] = nearest  - in.radius - eps;
+	hi[k] = farthest - in.radius + eps;
+	break;
+      }
+
+      case LEAF:
+	lo[k] = -FLT_MAX;
+	hi[k] =  FLT_MAX;
+	break;
+
+      case UNION:
+	lo[k] = std::min(lo[sa], lo[sb]);
+	hi[k] = std::min(hi[sa], hi[sb]);
+	break;
+
+      case INTERSECTION:
+	lo[k] = std::max(lo[sa], lo[sb]);
+	hi[k] = std::max(hi[sa], hi[sb]);
+	break;
+
+      case DIFFERENCE:
+	lo[k] = std::max(lo[sa], -hi[sb]);
+	hi[k] = std::max(hi[sa], -lo[sb]);
+	break;
+    }
+  }
+
+
+  // top down: an operand whose interval lies entirely on the wrong side
+  // of the other one's is not needed, nor is its subtree. The bound of a
+  // node is the upper bound of the unions it is in: where its distance
+  // is larger, a member of one of them is smaller, so the union's result
+  // does not depend on it.
+  std::vector<float>& bound = _ws.bound;
+
+  _pruned.clear();
+  needed[_tape.back().instruction] = 1;
+  bound[_tape.back().instruction]  = FLT_MAX;
+
+  for (i=(int)_tape.size()-1; i>=0; --i)
+  {
+    const int          k  = _tape[i].instruction;
+    const int          sa = _tape[i].a, sb = _tape[i].b;
+    const Instruction& in = code_[k];
+
+    if (!needed[k])
+      continue;
+    needed[k] = 0;
+
+    Step step = _tape[i];
+    _pruned.push_back(step);
+    if (sa < 0)
+      continue;
+
+    bool   need_a(step.mode == EVALUATE || step.mode == COPY_A);
+    bool   need_b(step.mode != COPY_A);
+    float  bound_a(bound[k]), bound_b(bound[k]);
+
+    if (step.mode == EVALUATE)
+    {
+      switch (in.op)
+      {
+	case UNION:
+	  bound_a = std::min(bound[k], hi[sb]);
+	  bound_b = std::min(bound[k], hi[sa]);
+	  if      (lo[sb] > bound_b)  need_b = false;
+	  else if (lo[sa] > bound_a)  need_a = false;
+	  if (!need_b)  bound_a = bound[k];
+	  if (!need_a)  bound_b = bound[k];
+	  break;
+
+	case INTERSECTION:
+	  if      (lo[sa] > hi[sb])  need_b = false;
+	  else if (lo[sb] > hi[sa])  need_a = false;
+	  bound_a = need_b ? FLT_MAX : bound[k];
+	  bound_b = need_a ? FLT_MAX : bound[k];
+	  break;
+
+	case DIFFERENCE:
+	  if      (lo[sa] > -lo[sb]) need_b = false;
+	  else if (-hi[sb] > hi[sa]) need_a = false;
+	  bound_a = need_b ? FLT_MAX : bound[k];
+	  bound_b = FLT_MAX;
+	  break;
+
+	default:
+	  break;
+      }
+
+      if (!need_a)       _pruned.back().mode = (in.op == DIFFERENCE) ? NEGATE_B : COPY_B;
+      else if (!need_b)  _pruned.back().mode = COPY_A;
+    }
+    else if (step.mode == NEGATE_B)
+    {
+      bound_b = FLT_MAX;
+    }
+
+    if (need_a)  { needed[sa] = 1;  bound[sa] = bound_a; }
+    if (need_b)  { needed[sb] = 1;  bound[sb] = bound_b; }
+  }
+
+  std::reverse(_pruned.begin(), _pruned.end());
+
+
+  // a copy to the same register is dropped, its users read the operand
+  std::vector<int>& alias = _ws.alias;
+  unsigned int n(0);
+
+  for (i=0; i<(int)_pruned.size(); ++i)
+  {
+    Step& step = _pruned[i];
+    const int k = step.instruction;
+
+    if (step.a >= 0)
+    {
+      if (step.mode != COPY_B && step.mode != NEGATE_B)  step.a = alias[step.a];
+      if (step.mode != COPY_A)                           step.b = alias[step.b];
+    }
+
+    const int copied = (step.mode == COPY_A) ? step.a : (step.mode == COPY_B) ? step.b : -1;
+    if (copied >= 0 && code_[copied].reg == code_[k].reg)
+    {
+      alias[k] = copied;
+    }
+    else
+    {
+      alias[k] = k;
+      _pruned[n++] = step;
+    }
+  }
+  _pruned.resize(n);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void
+CompiledCSG::
+evaluate(const Tape& _tape,
+	 const float* _x, const float* _y, const float* _z, int _n,
+	 float* _d, Workspace& _ws) const
+{
+  float* registers = &_ws.registers[0];
+
+  for (unsigned int i=0; i<_tape.size(); ++i)
+  {
+    const Step&        step = _tape[i];
+    const Instruction& in   = code_[step.instruction];
+    float* d = registers + in.reg * CHUNK;
+
+    if (in.op == SPHERE)
+    {
+      sphere_distances(in.center, in.radius, _x, _y, _z, _n, d);
+      continue;
+    }
+    if (in.op == LEAF)
+    {
+      in.leaf->scalar_distances(_x, _y, _z, _n, d);
+      continue;
+    }
+
+    const float* a = registers + code_[step.a].reg * CHUNK;
+    const float* b = registers + code_[step.b].reg * CHUNK;
+    int j;
+
+    switch (step.mode)
+    {
+      case COPY_A:
+	if (a != d) std::copy(a, a+_n, d);
+	break;
+
+      case COPY_B:
+	if (b != d) std::copy(b, b+_n, d);
+	break;
+
+      case NEGATE_B:
+	for (j=0; j<_n; ++j)
+	  d[j] = -b[j];
+	break;
+
+      default:
+	switch (in.op)
+	{
+	  case UNION:        combine<CSG::UnionOp>(a, b, _n, d);         break;
+	  case INTERSECTION: combine<CSG::IntersectionOp>(a, b, _n, d);  break;
+	  case DIFFERENCE:   combine<CSG::DifferenceOp>(a, b, _n, d);    break;
+	  default: break;
+	}
+	break;
+    }
+  }
+
+  const float* result = registers + code_[_tape.back().instruction].reg * CHUNK;
+  std::copy(result, result+_n, _d);
+}
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
@@ -0,0 +1,204 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------* 
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+//=============================================================================
+//
+//  CLASS CompiledCSG
+//
+//=============================================================================
+
+
+#ifndef ISOEX_COMPILEDCSG_HH
+#define ISOEX_COMPILEDCSG_HH
+
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Implicits/Implicit.hh>
+#include <vector>
+#include <map>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \class CompiledCSG CompiledCSG.hh <IsoEx/Implicits/CompiledCSG.hh>
+
+    Evaluates a tree of CSG::Union, CSG::Intersection and CSG::Difference
+    nodes without the recursion through their virtual functions. The
+    constructor flattens the tree into a linear program: one instruction
+    per node in post-order, each writing its result to a register. The
+    registers are assigned like a stack, the operand needing more
+    registers is evaluated first, so a tree of n nodes needs at most
+    log2(n)+1 registers.
+
+    ImplicitSphere leaves are evaluated inline, all other implicits are
+    leaves that are called through their scalar_distances().
+
+    scalar_distances() bounds every node's distance over the bounding
+    box of the points by interval arithmetic and drops the operands that
+    cannot contribute from the program, e.g. the members of a union
+    that are farther away than the upper bound of another member, also
+    of one further up in a chain of unions. It then splits the points in
+    halves and prunes the shortened program further for each half, down
+    to chunks of CHUNK points. These are evaluated one instruction after
+    the other, for the whole chunk at once and vectorized by SSE2. The
+    results are the same as the ones of the tree. Compact batches prune
+    best, e.g. the bricks of BrickedScalarGridT::sample_function(), the
+    long thin boxes of grid rows less so.
+
+    The tree has to outlive the compiled program, directed_distance() is
+    passed on to its root.
+
+    \ingroup implicits
+*/
+class CompiledCSG : public Implicit
+{
+public:
+
+  /// Compiles the tree below \b _root
+  CompiledCSG(const Implicit& _root);
+
+  /// Destructor
+  ~CompiledCSG() {}
+
+
+  /// \name Mandatory interface of implicit objects, see also IsoEx::Implicit.
+  //@{
+
+  bool   is_inside(const OpenMesh::Vec3f& _p) const;
+
+  float  scalar_distance(const OpenMesh::Vec3f& _p) const;
+
+  bool   directed_distance(const OpenMesh::Vec3f&  _p0,
+			   const OpenMesh::Vec3f&  _p1,
+			   OpenMesh::Vec3f&        _point,
+			   OpenMesh::Vec3f&        _normal,
+			   float&                  _distance) const {
+    return root_.directed_distance(_p0, _p1, _point, _normal, _distance);
+  }
+
+  void   scalar_distances(const float* _x, const float* _y, const float* _z,
+			  int _n, float* _d) const;
+
+  //@}
+
+
+  /// Number of instructions, i.e. nodes of the tree
+  unsigned int n_instructions() const { return (unsigned int)code_.size(); }
+
+  /// Number of registers the program needs
+  unsigned int n_registers() const { return n_registers_; }
+
+
+private:
+
+  enum OpCode { SPHERE, LEAF, UNION, INTERSECTION, DIFFERENCE };
+
+  struct Instruction
+  {
+    OpCode           op;
+    int              reg;      // result register
+    int              a, b;     // operand instructions of UNION, ...
+    OpenMesh::Vec3f  center;   // SPHERE
+    float            radius;   // SPHERE
+    const Implicit*  leaf;     // LEAF
+  };
+
+  // what to do with an instruction of a pruned program
+  enum Mode { EVALUATE, COPY_A, COPY_B, NEGATE_B };
+
+  // an instruction of a pruned program, reading the results of the
+  // instructions a and b instead of the ones of its operands
+  struct Step
+  {
+    int            instruction;
+    int            a, b;
+    unsigned char  mode;
+  };
+
+  typedef std::vector<Step>  Tape;
+
+  // buffers of one scalar_distances() call
+  struct Workspace
+  {
+    std::vector<float>          lo, hi;      // per instruction
+    std::vector<float>          bound;       // per instruction
+    std::vector<int>            alias;       // per instruction
+    std::vector<unsigned char>  needed;      // per instruction
+    std::vector<Tape>           tapes;       // per level of subdivision
+    std::vector<float>          registers;   // n_registers_ * CHUNK
+  };
+
+  typedef std::map<const Implicit*, int>  RegisterCount;
+
+
+  // the operator and operands of a CSG node, false for leaves
+  static bool is_operator(const Implicit& _node, OpCode& _op,
+			  const Implicit*& _a, const Implicit*& _b);
+
+  // number of registers the subtree of _node needs, memoized in _count
+  int registers(const Implicit& _node, RegisterCount& _count) const;
+
+  // append the code of _node's subtree, result in register _reg,
+  // returns the index of the node's instruction
+  int compile(const Implicit& _node, int _reg, RegisterCount& _count);
+
+  // evaluate the points [_first,_last) by _tape, pruned for their box
+  void evaluate_range(const Tape& _tape, unsigned int _level,
+		      const float* _x, const float* _y, const float* _z,
+		      int _first, int _last, float* _d, Workspace& _ws) const;
+
+  // the steps of _tape needed for points in the box [_bmin,_bmax]
+  void prune(const Tape& _tape, const float _bmin[3], const float _bmax[3],
+	     Tape& _pruned, Workspace& _ws) const;
+
+  // run _tape on _n <= CHUNK points
+  void evaluate(const Tape& _tape,
+		const float* _x, const float* _y, const float* _z, int _n,
+		float* _d, Workspace& _ws) const;
+
+
+private:
+
+  // points per chunk, and a bound of n_registers() for the point-wise
+  // evaluation
+  enum { CHUNK = 128, MAX_REGISTERS = 64 };
+
+  const Implicit&           root_;
+  std::vector<Instruction>  code_;
+  Tape                      tape_;
+  int                       n_registers_;
+};
+
+
+//=============================================================================
+} // namespace IsoEx
+//=============================================================================
+#endif // ISOEX_COMPILEDCSG_HH defined
+//=============================================================================
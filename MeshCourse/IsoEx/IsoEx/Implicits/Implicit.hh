@@ -100,6 +100,25 @@ public:
 				 OpenMesh::Vec3f&        _normal,
 				 float&                  _distance) const = 0;
   //@}
+
+
+
+  /// \name Batch interface
+  //@{
+
+  /** Computes scalar_distance() of the \b _n points (_x[i],_y[i],_z[i]),
+      given in structure-of-arrays layout, and stores them in \b _d[i].
+      The default implementation evaluates one point after the other,
+      derived classes override it by vectorized code.
+  */
+  virtual void scalar_distances(const float* _x, const float* _y,
+				const float* _z, int _n, float* _d) const
+  {
+    for (int i=0; i<_n; ++i)
+      _d[i] = scalar_distance(OpenMesh::Vec3f(_x[i], _y[i], _z[i]));
+  }
+
+  //@}
 };
 
 
@@ -37,6 +37,7 @@
 //== INCLUDES =================================================================
 
 #include <IsoEx/Implicits/Implicit.hh>
+#include <IsoEx/Math/SSE.hh>
 
 //== NAMESPACES ===============================================================
 
@@ -120,9 +121,40 @@ public:
     return false;
   }
   
+  void scalar_distances(const float* _x, const float* _y, const float* _z,
+			int _n, float* _d) const
+  {
+    int i(0);
+
+#ifdef ISOEX_SSE2
+    const __m128 cx(_mm_set1_ps(center_[0])), cy(_mm_set1_ps(center_[1])),
+                 cz(_mm_set1_ps(center_[2])), r(_mm_set1_ps(radius_));
+
+    for (; i+4<=_n; i+=4)
+    {
+      __m128 dx = _mm_sub_ps(cx, _mm_loadu_ps(_x+i));
+      __m128 dy = _mm_sub_ps(cy, _mm_loadu_ps(_y+i));
+      __m128 dz = _mm_sub_ps(cz, _mm_loadu_ps(_z+i));
+      __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+			     _mm_mul_ps(dz, dz));
+      _mm_storeu_ps(_d+i, _mm_sub_ps(_mm_sqrt_ps(d2), r));
+    }
+#endif
+
+    for (; i<_n; ++i)
+      _d[i] = scalar_distance(OpenMesh::Vec3f(_x[i], _y[i], _z[i]));
+  }
+
   //@}
 
 
+  /// Sphere center
+  const OpenMesh::Vec3f& center() const { return center_; }
+
+  /// Sphere radius
+  float radius() const { return radius_; }
+
+
 private:
 
   OpenMesh::Vec3f  center_;
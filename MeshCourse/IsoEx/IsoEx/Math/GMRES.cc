@@ -0,0 +1,147 @@
+//=============================================================================
+//
+//  FUNCTION gmres - IMPLEMENTATION
+//
+//=============================================================================
+
+#define ISOEX_GMRES_C
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Math/GMRES.hh>
+#include <cmath>
+
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+namespace Math {
+
+//== IMPLEMENTATION ==========================================================
+
+
+template <class Operator, class Preconditioner>
+int
+gmres( const Operator& _A, const Preconditioner& _M,
+       const std::vector<double>& _b, std::vector<double>& _x,
+       int _restart, int _max_iterations, double& _tolerance )
+{
+  const int  n = (int)_b.size();
+  const int  m = _restart;
+  int        i, j, k, iter = 0;
+
+  double b_norm = 0;
+  for (i = 0; i < n; ++i)  b_norm += _b[i] * _b[i];
+  b_norm = std::sqrt(b_norm);
+  if (b_norm == 0)
+  {
+    _x.assign(n, 0.0);
+    _tolerance = 0;
+    return 0;
+  }
+
+  std::vector< std::vector<double> >  V(m+1, std::vector<double>(n));
+  std::vector< std::vector<double> >  H(m+1, std::vector<double>(m, 0.0));
+  std::vector<double>  cs(m), sn(m), g(m+1), y(m), r(n), z(n), w(n), x_best;
+
+  // true residual r = b - A x
+  _A(_x, r);
+  double beta = 0;
+  for (i = 0; i < n; ++i)
+  {
+    r[i] = _b[i] - r[i];
+    beta += r[i] * r[i];
+  }
+  beta = std::sqrt(beta);
+  double beta_best = beta;
+  x_best = _x;
+
+  while (beta > _tolerance * b_norm && iter < _max_iterations)
+  {
+    for (i = 0; i < n; ++i)  V[0][i] = r[i] / beta;
+    g.assign(m+1, 0.0);
+    g[0] = beta;
+
+    // Arnoldi process with modified Gram-Schmidt, the Hessenberg matrix is
+    // reduced to triangular form by Givens rotations on the fly
+    for (j = 0; j < m && iter < _max_iterations; )
+    {
+      _M(V[j], z);
+      _A(z, w);
+      ++iter;
+
+      for (k = 0; k <= j; ++k)
+      {
+        double h = 0;
+        for (i = 0; i < n; ++i)  h += w[i] * V[k][i];
+        for (i = 0; i < n; ++i)  w[i] -= h * V[k][i];
+        H[k][j] = h;
+      }
+      double h = 0;
+      for (i = 0; i < n; ++i)  h += w[i] * w[i];
+      h = std::sqrt(h);
+      H[j+1][j] = h;
+      if (h != 0)
+        for (i = 0; i < n; ++i)  V[j+1][i] = w[i] / h;
+
+      for (k = 0; k < j; ++k)
+      {
+        double t  =  cs[k] * H[k][j] + sn[k] * H[k+1][j];
+        H[k+1][j] = -sn[k] * H[k][j] + cs[k] * H[k+1][j];
+        H[k][j]   =  t;
+      }
+      double d = std::sqrt(H[j][j] * H[j][j] + h * h);
+      cs[j] = H[j][j] / d;
+      sn[j] = h / d;
+      H[j][j]   = d;
+      H[j+1][j] = 0;
+      g[j+1] = -sn[j] * g[j];
+      g[j]   =  cs[j] * g[j];
+
+      ++j;
+      if (std::fabs(g[j]) <= _tolerance * b_norm || h == 0)
+        break;
+    }
+
+    // x += M^-1 V y with the least squares solution y of H y = g
+    for (k = j-1; k >= 0; --k)
+    {
+      y[k] = g[k];
+      for (i = k+1; i < j; ++i)  y[k] -= H[k][i] * y[i];
+      y[k] /= H[k][k];
+    }
+    w.assign(n, 0.0);
+    for (k = 0; k < j; ++k)
+      for (i = 0; i < n; ++i)
+        w[i] += y[k] * V[k][i];
+    _M(w, z);
+    for (i = 0; i < n; ++i)  _x[i] += z[i];
+
+    // restart with the true residual
+    _A(_x, r);
+    beta = 0;
+    for (i = 0; i < n; ++i)
+    {
+      r[i] = _b[i] - r[i];
+      beta += r[i] * r[i];
+    }
+    beta = std::sqrt(beta);
+
+    // in finite precision the residual stagnates at some level, stop with
+    // the best solution when a whole cycle did not reduce it
+    if (!(beta < beta_best))
+      break;
+    beta_best = beta;
+    x_best    = _x;
+  }
+
+  _x.swap(x_best);
+  _tolerance = beta_best / b_norm;
+  return iter;
+}
+
+
+//=============================================================================
+} // namespace Math
+} // namespace IsoEx
+//=============================================================================
@@ -0,0 +1,57 @@
+//=============================================================================
+//
+//  FUNCTION gmres
+//
+//=============================================================================
+
+
+#ifndef ISOEX_GMRES_HH
+#define ISOEX_GMRES_HH
+
+
+//== INCLUDES =================================================================
+
+#include <vector>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+namespace Math {
+
+//== FUNCTION DEFINITION ======================================================
+
+
+/** Restarted, right preconditioned GMRES for A x = b.
+
+    The matrix is never accessed directly, so it can be applied matrix-free:
+    _A(x, y) computes y = A x and _M(r, z) applies the preconditioner,
+    z = M^-1 r, both for std::vector<double>. _x holds the initial guess
+    on input and the solution on output.
+
+    The iteration stops when the 2-norm of the residual relative to the one
+    of _b is below _tolerance or after _max_iterations matrix-vector
+    products, or when a restart cycle did not reduce the residual, which
+    happens once it reaches the accuracy limit of ill-conditioned systems.
+    _x is the iterate with the smallest residual then. The Krylov basis is
+    restarted every _restart iterations and needs (_restart + 1) vectors of
+    memory. On return _tolerance holds the achieved relative residual, the
+    number of iterations is returned.
+*/
+template <class Operator, class Preconditioner>
+int
+gmres( const Operator& _A, const Preconditioner& _M,
+       const std::vector<double>& _b, std::vector<double>& _x,
+       int _restart, int _max_iterations, double& _tolerance );
+
+
+//=============================================================================
+} // namespace Math
+} // namespace IsoEx
+//=============================================================================
+#if defined(INCLUDE_TEMPLATES) && !defined(ISOEX_GMRES_C)
+#define ISOEX_GMRES_TEMPLATES
+#include "GMRES.cc"
+#endif
+//=============================================================================
+#endif // ISOEX_GMRES_HH defined
+//=============================================================================
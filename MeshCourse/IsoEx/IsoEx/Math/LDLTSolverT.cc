@@ -0,0 +1,423 @@
+//=============================================================================
+//
+//  CLASS LDLTSolverT - IMPLEMENTATION
+//
+//=============================================================================
+
+#define ISOEX_LDLTSOLVERT_C
+
+//== INCLUDES =================================================================
+
+#include <IsoEx/Math/LDLTSolverT.hh>
+#include <algorithm>
+#include <cmath>
+
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+namespace Math {
+
+//== IMPLEMENTATION ==========================================================
+
+
+template <typename Scalar>
+void
+LDLTSolverT<Scalar>::
+resize(int _n)
+{
+  n_ = _n;
+  data_.assign((size_t)_n * (_n+1) / 2, Scalar(0));
+  pivots_.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <typename Scalar>
+void
+LDLTSolverT<Scalar>::
+swap_rows(int _i, int _j, int _first, int _last)
+{
+  for (int c = _first; c <= _last; ++c)
+    std::swap((*this)(_i,c), (*this)(_j,c));
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <typename Scalar>
+bool
+LDLTSolverT<Scalar>::
+factorize(int _block_size)
+{
+  int nb = std::max(2, std::min(_block_size, n_));
+  pivots_.assign(n_, 0);
+  work_.assign((size_t)n_ * nb, Scalar(0));
+
+  bool singular = false;
+  for (int k = 0; k < n_; )
+    k += factorize_panel(k, nb, singular);
+
+  std::vector<Scalar>().swap(work_);
+  return !singular;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// Lower triangular variant of LAPACK's dlasyf. Column c of work_ holds the
+// column k0+c of the matrix with all updates of the panel applied, i.e. the
+// corresponding column of L D. pivots_[k] = p >= 0 means that rows and
+// columns k and p were interchanged and D has a 1x1 block at k. For a 2x2
+// block at k, k+1 both entries are -(p+1), rows and columns k+1 and p were
+// interchanged. As in LAPACK, later interchanges are not applied to the
+// earlier columns of L.
+template <typename Scalar>
+int
+LDLTSolverT<Scalar>::
+factorize_panel(int _k0, int _nb, bool& _singular)
+{
+  const int     n     = n_;
+  const bool    last  = (n - _k0 <= _nb);
+  const Scalar  alpha = Scalar((1.0 + std::sqrt(17.0)) / 8.0);
+  int           i, k, p;
+
+  for (k = _k0; k < n; )
+  {
+    const int kl = k - _k0;
+    if (!last && kl >= _nb-1)
+      break;
+
+    // column k with the delayed updates of the panel
+    Scalar* w0 = &work_[(size_t)kl * n];
+    const Scalar* ak = column(k);
+    for (i = k; i < n; ++i)
+      w0[i] = ak[i-k];
+    for (p = _k0; p < k; ++p)
+    {
+      const Scalar* lp = column(p) - p;
+      const Scalar  wp = work_[(size_t)(p-_k0) * n + k];
+      if (wp != 0)
+        for (i = k; i < n; ++i)
+          w0[i] -= lp[i] * wp;
+    }
+
+    // Bunch-Kaufman pivot search
+    int     kstep  = 1, kp = k, imax = k;
+    Scalar  absakk = std::fabs(w0[k]), colmax = 0;
+    for (i = k+1; i < n; ++i)
+    {
+      if (std::fabs(w0[i]) > colmax)
+      {
+        colmax = std::fabs(w0[i]);
+        imax   = i;
+      }
+    }
+
+    if (std::max(absakk, colmax) == 0)
+    {
+      _singular = true;
+    }
+    else if (absakk < alpha * colmax)
+    {
+      // column imax with the delayed updates of the panel
+      Scalar* w1 = &work_[(size_t)(kl+1) * n];
+      for (i = k; i < imax; ++i)
+        w1[i] = (*this)(imax, i);
+      const Scalar* aimax = column(imax);
+      for (i = imax; i < n; ++i)
+        w1[i] = aimax[i-imax];
+      for (p = _k0; p < k; ++p)
+      {
+        const Scalar* lp = column(p) - p;
+        const Scalar  wp = work_[(size_t)(p-_k0) * n + imax];
+        if (wp != 0)
+          for (i = k; i < n; ++i)
+            w1[i] -= lp[i] * wp;
+      }
+
+      Scalar rowmax = 0;
+      for (i = k; i < n; ++i)
+        if (i != imax)
+          rowmax = std::max(rowmax, std::fabs(w1[i]));
+
+      if (absakk >= alpha * colmax * (colmax / rowmax))
+      {
+        // no interchange, 1x1 pivot
+      }
+      else if (std::fabs(w1[imax]) >= alpha * rowmax)
+      {
+        // interchange k and imax, 1x1 pivot
+        kp = imax;
+        std::copy(w1 + k, w1 + n, w0 + k);
+      }
+      else
+      {
+        // interchange k+1 and imax, 2x2 pivot
+        kp    = imax;
+        kstep = 2;
+      }
+    }
+
+    // interchange rows and columns kk and kp of the trailing matrix, which
+    // has no updates applied yet, and the rows of the factored columns
+    const int kk = k + kstep - 1;
+    if (kp != kk)
+    {
+      (*this)(kp,kp) = (*this)(kk,kk);
+      for (i = kk+1; i < kp; ++i)
+        (*this)(kp,i) = (*this)(i,kk);
+      const Scalar* ckk = column(kk) - kk;
+      Scalar*       ckp = column(kp) - kp;
+      for (i = kp+1; i < n; ++i)
+        ckp[i] = ckk[i];
+      swap_rows(kk, kp, _k0, k-1);
+      for (int c = 0; c <= kk-_k0; ++c)
+        std::swap(work_[(size_t)c * n + kk], work_[(size_t)c * n + kp]);
+    }
+
+    // store the column(s) of L and the block of D
+    if (kstep == 1)
+    {
+      Scalar* ck = column(k) - k;
+      std::copy(w0 + k, w0 + n, ck + k);
+      if (ck[k] != 0)
+      {
+        const Scalar r = Scalar(1) / ck[k];
+        for (i = k+1; i < n; ++i)
+          ck[i] *= r;
+      }
+      pivots_[k] = kp;
+    }
+    else
+    {
+      const Scalar* w1  = &work_[(size_t)(kl+1) * n];
+      Scalar*       ck  = column(k)   - k;
+      Scalar*       ck1 = column(k+1) - (k+1);
+      if (k < n-2)
+      {
+        // multiply by the inverse of the 2x2 block
+        Scalar d21 = w0[k+1];
+        Scalar d11 = w1[k+1] / d21;
+        Scalar d22 = w0[k]   / d21;
+        Scalar t   = Scalar(1) / (d11 * d22 - Scalar(1));
+        d21 = t / d21;
+        for (i = k+2; i < n; ++i)
+        {
+          ck[i]  = d21 * (d11 * w0[i] - w1[i]);
+          ck1[i] = d21 * (d22 * w1[i] - w0[i]);
+        }
+      }
+      ck[k]    = w0[k];
+      ck[k+1]  = w0[k+1];
+      ck1[k+1] = w1[k+1];
+      pivots_[k] = pivots_[k+1] = -(kp+1);
+    }
+
+    k += kstep;
+  }
+
+
+  // update the trailing matrix A22 -= L21 W^T, column by column in parallel.
+  // Rows are processed in chunks that stay in the cache for all columns of
+  // the panel, four columns of the panel are applied at once.
+  const int nc = k - _k0;
+  const int ROWS = 512;
+#pragma omp parallel for schedule(dynamic, 4)
+  for (int j = k; j < n; ++j)
+  {
+    Scalar* aj = column(j) - j;
+    for (int i0 = j; i0 < n; i0 += ROWS)
+    {
+      const int i1 = std::min(n, i0 + ROWS);
+      int c = 0;
+      for (; c+4 <= nc; c += 4)
+      {
+        const Scalar  w0 = work_[(size_t)c * n + j];
+        const Scalar  w1 = work_[(size_t)(c+1) * n + j];
+        const Scalar  w2 = work_[(size_t)(c+2) * n + j];
+        const Scalar  w3 = work_[(size_t)(c+3) * n + j];
+        const Scalar* l0 = column(_k0+c)   - (_k0+c);
+        const Scalar* l1 = column(_k0+c+1) - (_k0+c+1);
+        const Scalar* l2 = column(_k0+c+2) - (_k0+c+2);
+        const Scalar* l3 = column(_k0+c+3) - (_k0+c+3);
+        for (int r = i0; r < i1; ++r)
+          aj[r] -= (l0[r] * w0 + l1[r] * w1) + (l2[r] * w2 + l3[r] * w3);
+      }
+      for (; c < nc; ++c)
+      {
+        const Scalar  w  = work_[(size_t)c * n + j];
+        const Scalar* lc = column(_k0+c) - (_k0+c);
+        for (int r = i0; r < i1; ++r)
+          aj[r] -= lc[r] * w;
+      }
+    }
+  }
+
+
+  // undo the row interchanges of later pivots in the columns of the panel
+  for (int j = k-1; j >= _k0; )
+  {
+    int jj = j, jp = pivots_[j];
+    if (jp < 0)
+    {
+      jp = -jp - 1;
+      --j;
+    }
+    --j;
+    if (jp != jj && j >= _k0)
+      swap_rows(jp, jj, _k0, j);
+  }
+
+  return nc;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <typename Scalar>
+template <class Vector>
+void
+LDLTSolverT<Scalar>::
+solve(Vector& _x) const
+{
+  const int n = n_;
+  int       i, k;
+
+  // solve L D y = P b
+  for (k = 0; k < n; )
+  {
+    if (pivots_[k] >= 0)
+    {
+      const int kp = pivots_[k];
+      if (kp != k) std::swap(_x[k], _x[kp]);
+
+      const Scalar* ck = column(k) - k;
+      const double  xk = _x[k];
+      for (i = k+1; i < n; ++i)
+        _x[i] -= ck[i] * xk;
+      _x[k] = xk / ck[k];
+      k += 1;
+    }
+    else
+    {
+      const int kp = -pivots_[k] - 1;
+      if (kp != k+1) std::swap(_x[k+1], _x[kp]);
+
+      const Scalar* ck  = column(k)   - k;
+      const Scalar* ck1 = column(k+1) - (k+1);
+      const double  xk = _x[k], xk1 = _x[k+1];
+      for (i = k+2; i < n; ++i)
+        _x[i] -= ck[i] * xk + ck1[i] * xk1;
+
+      const double d21   = ck[k+1];
+      const double d11   = ck[k]    / d21;
+      const double d22   = ck1[k+1] / d21;
+      const double denom = d11 * d22 - 1.0;
+      const double b1 = xk / d21, b2 = xk1 / d21;
+      _x[k]   = (d22 * b1 - b2) / denom;
+      _x[k+1] = (d11 * b2 - b1) / denom;
+      k += 2;
+    }
+  }
+
+  // solve L^T P x = y
+  for (k = n-1; k >= 0; )
+  {
+    if (pivots_[k] >= 0)
+    {
+      const Scalar* ck = column(k) - k;
+      double s = 0;
+      for (i = k+1; i < n; ++i)
+        s += ck[i] * _x[i];
+      _x[k] -= s;
+
+      const int kp = pivots_[k];
+      if (kp != k) std::swap(_x[k], _x[kp]);
+      k -= 1;
+    }
+    else
+    {
+      const Scalar* ck  = column(k)   - k;
+      const Scalar* ck1 = column(k-1) - (k-1);
+      double s = 0, s1 = 0;
+      for (i = k+1; i < n; ++i)
+      {
+        s  += ck[i]  * _x[i];
+        s1 += ck1[i] * _x[i];
+      }
+      _x[k]   -= s;
+      _x[k-1] -= s1;
+
+      const int kp = -pivots_[k] - 1;
+      if (kp != k) std::swap(_x[k], _x[kp]);
+      k -= 2;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Matrix, class Vector>
+bool
+solve_symmetric(const Matrix& _A, int _n, Vector& _x, const Vector& _b)
+{
+  int i, j, m = 0;
+
+  // index of the unknowns in the reduced system, -1 for fixed ones
+  std::vector<int> index(_n, -1);
+  for (i = 0; i < _n; ++i)
+  {
+    bool fixed = (_A(i,i) == 1.0);
+    for (j = 0; fixed && j < _n; ++j)
+      if (j != i && _A(i,j) != 0.0)
+        fixed = false;
+    if (!fixed)
+      index[i] = m++;
+  }
+
+  LDLTSolverT<double>  ldlt(m);
+  std::vector<double>  x(m);
+  for (i = 0; i < _n; ++i)
+  {
+    if (index[i] < 0) continue;
+
+    double b = _b[i];
+    for (j = 0; j < _n; ++j)
+    {
+      if (index[j] < 0)
+      {
+        b -= _A(i,j) * _b[j];
+      }
+      else if (j <= i)
+      {
+        double a = _A(i,j), at = _A(j,i);
+        if (std::fabs(a - at) > 1e-12 * (std::fabs(a) + std::fabs(at)))
+          return false;
+        ldlt(index[i], index[j]) = a;
+      }
+    }
+    x[index[i]] = b;
+  }
+
+  if (!ldlt.factorize())
+    return false;
+  ldlt.solve(x);
+
+  for (i = 0; i < _n; ++i)
+    _x[i] = (index[i] < 0) ? _b[i] : x[index[i]];
+  return true;
+}
+
+
+//=============================================================================
+} // namespace Math
+} // namespace IsoEx
+//=============================================================================
@@ -0,0 +1,117 @@
+//=============================================================================
+//
+//  CLASS LDLTSolverT
+//
+//=============================================================================
+
+
+#ifndef ISOEX_LDLTSOLVERT_HH
+#define ISOEX_LDLTSOLVERT_HH
+
+
+//== INCLUDES =================================================================
+
+#include <vector>
+#include <cstddef>
+
+//== NAMESPACES ===============================================================
+
+namespace IsoEx {
+namespace Math {
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \class LDLTSolverT LDLTSolverT.hh <IsoEx/Math/LDLTSolverT.hh>
+
+    Dense solver for symmetric, possibly indefinite linear systems.
+
+    Only the lower triangle of the matrix is stored, packed column by
+    column, which takes half the memory of a full dense matrix. factorize()
+    computes P A P^T = L D L^T with Bunch-Kaufman pivoting, where L is unit
+    lower triangular and D is block diagonal with 1x1 and 2x2 blocks. The
+    factorization is blocked like LAPACK's dsytrf: a panel of columns is
+    factored with delayed updates, then the trailing matrix gets one
+    rank-(block size) update, which is spread over the OpenMP threads.
+    The factors overwrite the matrix.
+
+    The scalar type is the template parameter, float halves the memory
+    once more at the cost of accuracy.
+*/
+template <typename Scalar>
+class LDLTSolverT
+{
+public:
+
+  /// Construct an _n x _n zero matrix.
+  LDLTSolverT(int _n = 0) { resize(_n); }
+
+  /// Resize to an _n x _n zero matrix.
+  void resize(int _n);
+
+  /// Dimension of the matrix
+  int size() const { return n_; }
+
+  /// Element access, only the lower triangle _i >= _j is stored.
+  Scalar& operator()(int _i, int _j) { return column(_j)[_i-_j]; }
+
+  /// Read only element access, _i >= _j
+  const Scalar& operator()(int _i, int _j) const { return column(_j)[_i-_j]; }
+
+  /** Factorize the matrix, columns are processed in panels of _block_size.
+      Returns false if the matrix is singular. */
+  bool factorize(int _block_size = 64);
+
+  /** Solve A x = b using the factorization. _x holds b on input and the
+      solution on output. It can be any vector type with operator[]. */
+  template <class Vector>
+  void solve(Vector& _x) const;
+
+
+private:
+
+  // pointer to the diagonal element of column _j
+  Scalar* column(int _j)
+  { return &data_[0] + (size_t)_j * (2*(size_t)n_ - _j + 1) / 2; }
+  const Scalar* column(int _j) const
+  { return &data_[0] + (size_t)_j * (2*(size_t)n_ - _j + 1) / 2; }
+
+  // factor the panel starting at column _k0 with at most _nb columns,
+  // returns the number of columns factored and updates the trailing matrix
+  int factorize_panel(int _k0, int _nb, bool& _singular);
+
+  // swap rows _i and _j in columns _first to _last
+  void swap_rows(int _i, int _j, int _first, int _last);
+
+
+private:
+
+  int                  n_;
+  std::vector<Scalar>  data_;    // lower triangle, packed by columns
+  std::vector<int>     pivots_;  // interchanges, see factorize_panel()
+  std::vector<Scalar>  work_;    // n x block size panel of L D
+};
+
+
+/** Solve _A _x = _b for a dense matrix _A of dimension _n (element access
+    _A(i,j)) that is symmetric except for rows of the identity matrix, like
+    the constraint rows of Dirichlet boundary conditions. The unknowns of
+    these rows are fixed to their right hand side and moved to the right hand
+    side of the other rows, the remaining symmetric system is solved by
+    LDLTSolverT<double>. Returns false if it is not symmetric or singular,
+    _x is undefined then. */
+template <class Matrix, class Vector>
+bool solve_symmetric(const Matrix& _A, int _n, Vector& _x, const Vector& _b);
+
+
+//=============================================================================
+} // namespace Math
+} // namespace IsoEx
+//=============================================================================
+#if defined(INCLUDE_TEMPLATES) && !defined(ISOEX_LDLTSOLVERT_C)
+#define ISOEX_LDLTSOLVERT_TEMPLATES
+#include "LDLTSolverT.cc"
+#endif
+//=============================================================================
+#endif // ISOEX_LDLTSOLVERT_HH defined
+//=============================================================================
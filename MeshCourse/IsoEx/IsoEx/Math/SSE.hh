@@ -0,0 +1,109 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                                IsoEx                                      *
+ *        Copyright (C) 2002 by Computer Graphics Group, RWTH Aachen         *
+ *                         www.rwth-graphics.de                              *
+ *                                                                           *
+ *---------------------------------------------------------------------------* 
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+//=============================================================================
+//
+//  SSE2 helpers for the batch evaluation of implicits
+//
+//=============================================================================
+
+#ifndef ISOEX_SSE_HH
+#define ISOEX_SSE_HH
+
+
+/** \file SSE.hh
+    This file defines ISOEX_SSE2 if the target supports SSE2 and provides
+    vectorized math functions that the SSE2 instruction set lacks.
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define ISOEX_SSE2
+#  include <emmintrin.h>
+#endif
+
+//== NAMESPACES ===============================================================
+namespace IsoEx {
+namespace Math {
+//=============================================================================
+
+#ifdef ISOEX_SSE2
+
+/**
+   Computes exp() of four floats. The argument is split into n*ln(2) + r
+   with |r| <= ln(2)/2, exp(r) is approximated by the minimax polynomial of
+   the Cephes library and 2^n is built from the exponent bits. The relative
+   error is about 2e-7, arguments below -88 give 0.
+*/
+inline __m128 exp_ps(__m128 _x)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  _x = _mm_min_ps(_x, _mm_set1_ps( 88.3762626647949f));
+  _x = _mm_max_ps(_x, _mm_set1_ps(-88.3762626647949f));
+
+  // n = floor(x / ln(2) + 1/2)
+  __m128  fx = _mm_add_ps(_mm_mul_ps(_x, _mm_set1_ps(1.44269504088896341f)),
+                          _mm_set1_ps(0.5f));
+  __m128i n  = _mm_cvttps_epi32(fx);
+  __m128  fn = _mm_cvtepi32_ps(n);
+  __m128  gt = _mm_and_ps(_mm_cmpgt_ps(fn, fx), one);
+  fn = _mm_sub_ps(fn, gt);
+  n  = _mm_cvttps_epi32(fn);
+
+  // r = x - n*ln(2), with ln(2) split into two parts for accuracy
+  _x = _mm_sub_ps(_x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+  _x = _mm_sub_ps(_x, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+  __m128 z = _mm_mul_ps(_x, _x);
+  __m128 y = _mm_set1_ps(1.9875691500e-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, _x), _mm_set1_ps(1.3981999507e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, _x), _mm_set1_ps(8.3334519073e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, _x), _mm_set1_ps(4.1665795894e-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, _x), _mm_set1_ps(1.6666665459e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, _x), _mm_set1_ps(5.0000001201e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, z), _mm_add_ps(_x, one));
+
+  // 2^n
+  n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+
+
+/// Sum of the four floats of \b _x
+inline float hsum_ps(__m128 _x)
+{
+  __m128 s = _mm_add_ps(_x, _mm_movehl_ps(_x, _x));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+}
+
+#endif
+
+//=============================================================================
+} // namespace Math
+} // namespace IsoEx
+//=============================================================================
+#endif // ISOEX_SSE_HH defined
+//=============================================================================